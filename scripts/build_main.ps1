@@ -24,7 +24,7 @@ Write-Host "Using g++ version $gccVersion"
 
 # compiler flags as arrays (so PowerShell passes them as separate args)
 $cxx = "g++"
-$cxxflags = @("-std=c++17", "-O2", "-g")
+$cxxflags = @("-std=c++17", "-O2", "-g", "-pthread")
 $includeFlags = @("-I.")
 
 # gather source files under src (exclude tests)
@@ -24,7 +24,7 @@ Write-Host "Using g++ version $gccVersion"
 
 # compiler flags as arrays
 $cxx = "g++"
-$cxxflags = @("-std=c++17", "-O2", "-g")
+$cxxflags = @("-std=c++17", "-O2", "-g", "-pthread")
 $includeFlags = @("-I.", "-DRUN_TESTS")
 
 # gather source files under src - EXCLUDE main.cpp for tests
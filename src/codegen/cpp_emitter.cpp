@@ -0,0 +1,772 @@
+#include "src/codegen/cpp_emitter.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace codegen {
+namespace {
+using Names = unordered_set<string>;
+
+// The natives plc_runtime.hpp provides, by arity
+const unordered_map<string, size_t> runtimeNatives = {
+    {"sort", 1},   {"sum", 1},       {"min", 1},       {"max", 1},       {"find", 2},
+    {"count", 2},  {"matrix", 2},    {"rows", 1},      {"cols", 1},      {"transpose", 1},
+    {"matmul", 2}, {"load_ints", 1}, {"save_ints", 2}, {"load_csv_ints", 2}};
+
+// Position of the parameter of a runtime native that takes a string literal
+const unordered_map<string, size_t> stringParameters = {{"load_ints", 0}, {"load_csv_ints", 0}, {"save_ints", 1}};
+
+// Script names get a prefix so they never collide with C++ keywords or the runtime. Optimizer temporaries start
+// with '$' and get a prefix of their own
+string cppName(const string& name) { return name[0] == '$' ? "t_" + name.substr(1) : "v_" + name; }
+
+string quoted(const string& text) { return "\"" + text + "\""; }
+
+// A script string as a C++ literal. Scripts have no escapes, but a path may hold backslashes
+string stringLiteral(const string& text) {
+    string escaped;
+    for (char c : text) escaped += c == '\\' ? "\\\\" : string(1, c);
+    return quoted(escaped);
+}
+
+string lineOf(const Node& node) { return to_string(node.token.lineNumber); }
+
+bool isInt(const Node& node) { return node.staticType == StaticType::INT; }
+
+/**
+ * Walks one unit (the top level or a function body) for the names assigned in it, and the names that ever hold or
+ * are read as something other than a proven int
+ */
+void collectTypes(const Node& node, Names& assigned, Names& notInt) {
+    switch (node.type) {
+        case NodeType::DEF:
+            return;  // Function bodies are units of their own
+
+        case NodeType::ASSIGN:
+            if (node.children.size() < 2) return;
+            if (node.children[0]->type == NodeType::VARIABLE) {
+                assigned.insert(node.children[0]->value);
+                if (!isInt(*node.children[1])) notInt.insert(node.children[0]->value);
+            } else {
+                for (size_t i = 1; i < node.children[0]->children.size(); i++) {
+                    collectTypes(*node.children[0]->children[i], assigned, notInt);
+                }
+            }
+            collectTypes(*node.children[1], assigned, notInt);
+            return;
+
+        case NodeType::FOR:
+            assigned.insert(node.value);
+            break;
+
+        case NodeType::VARIABLE:
+            if (!isInt(node)) notInt.insert(node.value);
+            return;
+
+        case NodeType::FUNC_CALL:
+            // The function named by pmap and preduce is not a variable read
+            if ((node.value == "pmap" || node.value == "preduce") && !node.children.empty()) {
+                for (size_t i = 1; i < node.children.size(); i++) collectTypes(*node.children[i], assigned, notInt);
+                return;
+            }
+            break;
+
+        default:
+            break;
+    }
+    for (const auto& child : node.children) {
+        if (child) collectTypes(*child, assigned, notInt);
+    }
+}
+
+// Same rule as Interpreter::evaluateParallel: bodies that print, call or define cannot run as pmap/preduce workers
+const Node* findUnsafeNode(const Node& node) {
+    if (node.type == NodeType::PRINT || node.type == NodeType::FUNC_CALL || node.type == NodeType::DEF) {
+        return &node;
+    }
+    for (const auto& child : node.children) {
+        if (!child) continue;
+        if (const Node* unsafe = findUnsafeNode(*child)) return unsafe;
+    }
+    return nullptr;
+}
+
+// A node the parser left a child of empty after reporting a syntax error, which the interpreter only reports at run
+// time
+const Node* findMissingChild(const Node& node) {
+    for (const auto& child : node.children) {
+        if (!child) return &node;
+        if (const Node* parent = findMissingChild(*child)) return parent;
+    }
+    return nullptr;
+}
+
+/**
+ * Translates statement by statement, tracking which names the interpreter's scopes would hold at each point so
+ * variables are declared in the C++ block where the interpreter would first create them. Anything the interpreter
+ * would report at run time (undefined names, calls to unknown functions) is translated into the same report.
+ */
+class Emitter {
+   public:
+    bool failed = false;
+    ostringstream definitions;
+    ostringstream mainBody;
+
+    void program(const Node& program) {
+        Names assigned, notInt;
+        collectTypes(program, assigned, notInt);
+        intNames.clear();
+        for (const auto& name : assigned) {
+            if (!notInt.count(name)) intNames.insert(name);
+        }
+        out = &mainBody;
+        scopes.assign(1, {});
+        if (!statements(program.children, "", true)) line("return plc::finish(0);");
+    }
+
+   private:
+    struct Variable {
+        string cpp;
+        bool isInt;
+    };
+    struct Function {
+        string cpp;
+        const Node* def;
+        vector<bool> intParams;
+    };
+
+    ostringstream* out = nullptr;
+    int depth = 1;
+    vector<unordered_map<string, Variable>> scopes;
+    unordered_map<string, Function> functions;  // Top-level definitions seen so far
+    unordered_map<string, int> definitionCount;
+    Names intNames;  // Names of the current unit declared as int
+    bool inFunction = false;
+    int nextTemporary = 0;
+
+    void line(const string& text) { *out << string(depth * 4, ' ') << text << "\n"; }
+
+    const Variable* find(const string& name) const {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto found = scope->find(name);
+            if (found != scope->end()) return &found->second;
+        }
+        return nullptr;
+    }
+
+    const Variable& declare(const string& name) {
+        return scopes.back()[name] = Variable{cppName(name), intNames.count(name) > 0};
+    }
+
+    string temporary(const string& stem) { return stem + to_string(nextTemporary++); }
+
+    // Expressions that cannot print, fail or change anything, so C++ may evaluate them in any order
+    bool pure(const Node& node) const {
+        switch (node.type) {
+            case NodeType::NUMBER:
+            case NodeType::STRING:
+                return true;
+            case NodeType::VARIABLE:
+                return find(node.value) != nullptr;
+            case NodeType::OPERATOR:
+            case NodeType::CONDITIONAL:
+                return node.value != "/" && isInt(*node.children[0]) && isInt(*node.children[1]) &&
+                       pure(*node.children[0]) && pure(*node.children[1]);
+            case NodeType::ARRAY:
+                for (const auto& child : node.children) {
+                    if (!pure(*child)) return false;
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * A call whose arguments run left to right. C++ leaves argument order unspecified, so once an argument has side
+     * effects the arguments are bound one by one in a lambda first
+     */
+    string invoke(const string& callee, const vector<const Node*>& nodes, const vector<string>& args) {
+        int effects = 0;
+        for (const Node* node : nodes) effects += !pure(*node);
+        string text;
+        if (nodes.size() < 2 || effects == 0) {
+            for (const auto& arg : args) text += (text.empty() ? "" : ", ") + arg;
+            return callee + "(" + text + ")";
+        }
+        string bound;
+        for (size_t i = 0; i < args.size(); i++) {
+            const string name = i < nodes.size() ? "a" + to_string(i) : args[i];
+            if (i < nodes.size()) bound += "auto&& " + name + " = " + args[i] + "; ";
+            text += (i > 0 ? ", " : "") + name;
+        }
+        return "[&] { " + bound + "return " + callee + "(" + text + "); }()";
+    }
+
+    string intExpr(const Node& node, bool nested = true) {
+        const string at = lineOf(node);
+        if (isInt(node)) {
+            switch (node.type) {
+                case NodeType::NUMBER:
+                    return to_string(node.number);
+
+                case NodeType::VARIABLE:
+                    if (const Variable* variable = find(node.value)) {
+                        return variable->isInt ? variable->cpp : "plc::toInt(" + variable->cpp + ", " + at + ")";
+                    }
+                    break;
+
+                case NodeType::OPERATOR:
+                case NodeType::CONDITIONAL: {
+                    if (!isInt(*node.children[0]) || !isInt(*node.children[1])) break;
+                    const string left = intExpr(*node.children[0]);
+                    const string right = intExpr(*node.children[1]);
+                    if (pure(node)) {
+                        const string text = left + " " + node.value + " " + right;
+                        return nested ? "(" + text + ")" : text;
+                    }
+                    return "plc::apply(" + quoted(node.value) + ", plc::Ints{" + left + ", " + right + "}, " + at + ")";
+                }
+
+                case NodeType::INDEX:
+                    if (node.children[0]->type == NodeType::INDEX) break;
+                    return invoke("plc::intAt", {node.children[0].get(), node.children[1].get()},
+                                  {valueExpr(*node.children[0]), expr(*node.children[1]), at});
+
+                default:
+                    break;
+            }
+        }
+        return "plc::toInt(" + valueExpr(node) + ", " + at + ")";
+    }
+
+    // An int expression when the node is proven int, otherwise a plc::Value
+    string expr(const Node& node) { return isInt(node) ? intExpr(node) : valueExpr(node); }
+
+    string valueExpr(const Node& node) {
+        const string at = lineOf(node);
+        switch (node.type) {
+            case NodeType::NUMBER:
+                return "plc::Value(" + to_string(node.number) + ")";
+
+            case NodeType::VARIABLE:
+                if (const Variable* variable = find(node.value)) {
+                    return variable->isInt ? "plc::Value(" + variable->cpp + ")" : variable->cpp;
+                }
+                return "plc::error(" + quoted("Variable '" + node.value + "' not found") + ", " + at + ")";
+
+            case NodeType::OPERATOR:
+            case NodeType::CONDITIONAL:
+                if (isInt(*node.children[0]) && isInt(*node.children[1])) return "plc::Value(" + intExpr(node) + ")";
+                return "plc::apply(" + quoted(node.value) + ", plc::Values{" + valueExpr(*node.children[0]) + ", " +
+                       valueExpr(*node.children[1]) + "}, " + at + ")";
+
+            case NodeType::ARRAY: {
+                string elements;
+                for (const auto& child : node.children) elements += (elements.empty() ? "" : ", ") + expr(*child);
+                return "plc::Value(plc::Array{" + elements + "})";
+            }
+
+            case NodeType::INDEX: {
+                const Node& base = *node.children[0];
+                if (base.type == NodeType::INDEX && base.children[0]->type == NodeType::VARIABLE) {
+                    const Variable* matrix = find(base.children[0]->value);
+                    if (matrix && !matrix->isInt) {
+                        return "plc::cell(" + matrix->cpp + ", plc::Ints{" + intExpr(*base.children[1]) + ", " +
+                               intExpr(*node.children[1]) + "}, " + at + ")";
+                    }
+                }
+                return invoke("plc::index", {&base, node.children[1].get()},
+                              {valueExpr(base), expr(*node.children[1]), at});
+            }
+
+            case NodeType::FUNC_CALL:
+                return call(node);
+
+            case NodeType::STRING:
+                return "plc::error(" + quoted("Strings can only be passed to natives") + ", " + at + ")";
+
+            default:
+                cerr << "ERROR: Cannot translate this expression to C++ at line " << at << endl;
+                failed = true;
+                return "plc::Value(0)";
+        }
+    }
+
+    string call(const Node& node) {
+        const string& name = node.value;
+        const string at = lineOf(node);
+        vector<const Node*> nodes;
+        for (const auto& child : node.children) nodes.push_back(child.get());
+
+        // Functions run in a frame of their own that has no functions defined, so only top-level code can call them
+        auto function = functions.find(name);
+        if (!inFunction && function != functions.end()) {
+            const Function& callee = function->second;
+            if (nodes.size() != callee.intParams.size()) {
+                string text = "(";
+                for (const Node* arg : nodes) {
+                    if (!pure(*arg)) text += "(void)(" + valueExpr(*arg) + "), ";
+                }
+                return text + "plc::error(" +
+                       quoted("Function '" + name + "' called with wrong number of arguments") + ", " + at + "))";
+            }
+            vector<string> args;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                args.push_back(callee.intParams[i] ? intExpr(*nodes[i]) : valueExpr(*nodes[i]));
+            }
+            return invoke(callee.cpp, nodes, args);
+        }
+
+        auto native = runtimeNatives.find(name);
+        if (native != runtimeNatives.end()) {
+            if (nodes.size() != native->second) {
+                return "plc::error(" + quoted("Function '" + name + "' called with wrong number of arguments") + ", " +
+                       at + ")";
+            }
+            // Natives read strings from the literal and reject any other argument in that position
+            auto stringParameter = stringParameters.find(name);
+            vector<string> args;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                const bool isString = nodes[i]->type == NodeType::STRING;
+                if (stringParameter != stringParameters.end() && stringParameter->second == i) {
+                    args.push_back(isString ? stringLiteral(nodes[i]->value)
+                                            : "plc::natives::notString(" + valueExpr(*nodes[i]) + ")");
+                } else {
+                    args.push_back(isString ? "plc::Value(0)" : valueExpr(*nodes[i]));
+                }
+            }
+            args.push_back(at);
+            return invoke("plc::natives::" + name, nodes, args);
+        }
+
+        if (name == "pmap" || name == "preduce") return parallel(node);
+        if (name == "checkpoint" && nodes.empty()) return "plc::Value(0)";
+        return "plc::error(" + quoted("Function '" + name + "' not defined") + ", " + at + ")";
+    }
+
+    /**
+     * pmap and preduce run their function over the array in order on the calling thread. preduce folds from init
+     * instead of chunk by chunk, which gives the same result for the associative functions it requires
+     */
+    string parallel(const Node& node) {
+        const string& name = node.value;
+        const string at = lineOf(node);
+        const bool isReduce = name == "preduce";
+        const size_t expectedArgs = isReduce ? 3 : 2;
+        const size_t expectedParams = isReduce ? 2 : 1;
+
+        if (node.children.size() != expectedArgs) {
+            return "plc::error(" + quoted("'" + name + "' expects " + to_string(expectedArgs) + " arguments") + ", " +
+                   at + ")";
+        }
+        const Node& funcArg = *node.children[0];
+        auto function = functions.find(funcArg.value);
+        if (inFunction || funcArg.type != NodeType::VARIABLE || function == functions.end()) {
+            return "plc::error(" + quoted("First argument of '" + name + "' must be a defined function") + ", " +
+                   at + ")";
+        }
+        const Function& callee = function->second;
+        if (callee.intParams.size() != expectedParams) {
+            return "plc::error(" +
+                   quoted("Function '" + funcArg.value + "' must take " + to_string(expectedParams) +
+                          " parameter(s) for '" + name + "'") +
+                   ", " + at + ")";
+        }
+        if (const Node* unsafe = findUnsafeNode(*callee.def->children.back())) {
+            return "plc::error(" +
+                   quoted("Function '" + funcArg.value + "' cannot run in parallel, it uses '" + unsafe->token.value +
+                          "'") +
+                   ", " + lineOf(*unsafe) + ")";
+        }
+
+        auto argument = [&](size_t param, const string& value) {
+            return callee.intParams[param] ? "plc::toInt(" + value + ", " + at + ")" : value;
+        };
+        string text = "[&] { const plc::Value input = " + valueExpr(*node.children[1]) + "; ";
+        text += "if (!input.isArray()) return plc::error(" +
+                quoted("Second argument of '" + name + "' must be an array") + ", " + at + "); ";
+        if (!isReduce) {
+            text += "plc::Array output; output.reserve(input.asArray().size()); ";
+            text += "for (const plc::Value& element : input.asArray()) output.push_back(" + callee.cpp + "(" +
+                    argument(0, "element") + ")); ";
+            return text + "return plc::Value(std::move(output)); }()";
+        }
+        text += "plc::Value result = " + valueExpr(*node.children[2]) + "; ";
+        text += "for (const plc::Value& element : input.asArray()) result = " + callee.cpp + "(" +
+                argument(0, "result") + ", " + argument(1, "element") + "); ";
+        return text + "return result; }()";
+    }
+
+    // `if` and `while` test for exactly 1, which comparisons produce directly
+    string condition(const Node& node) {
+        if (node.type == NodeType::CONDITIONAL && isInt(node)) return intExpr(node, false);
+        return intExpr(node) + " == 1";
+    }
+
+    /**
+     * Emits a block's statements. At the top of a unit a RETURN leaves the function; in a nested block it only ends
+     * the block, as in the interpreter. `result` names the variable that receives the block's value, if any.
+     * Returns whether the unit was left.
+     */
+    bool statements(const vector<unique_ptr<Node>>& children, const string& result, bool top) {
+        if (children.empty() && !result.empty()) line(result + " = 0;");
+        for (size_t i = 0; i < children.size(); i++) {
+            const Node& child = *children[i];
+            const bool last = i + 1 == children.size() || child.type == NodeType::RETURN;
+            if (child.type == NodeType::RETURN) return returnStatement(child, result, top);
+            statement(child, last ? result : "");
+            if (failed) return false;
+        }
+        return false;
+    }
+
+    void nested(const Node& body, const string& result) {
+        depth++;
+        scopes.emplace_back();
+        if (body.type == NodeType::BLOCK) {
+            statements(body.children, result, false);
+        } else {
+            statement(body, result);
+        }
+        scopes.pop_back();
+        depth--;
+    }
+
+    bool returnStatement(const Node& node, const string& result, bool top) {
+        const string value = node.children.empty() ? "plc::Value(0)" : valueExpr(*node.children[0]);
+        if (top) {
+            line(inFunction ? "return " + value + ";" : "return plc::finish(" + value + ");");
+            return true;
+        }
+        if (!result.empty()) {
+            line(result + " = " + value + ";");
+        } else if (!node.children.empty() && !pure(*node.children[0])) {
+            line(value + ";");
+        }
+        return false;
+    }
+
+    void statement(const Node& node, const string& result) {
+        const string at = lineOf(node);
+        switch (node.type) {
+            case NodeType::ASSIGN:
+                assign(node, result);
+                return;
+
+            case NodeType::COMPOUND_ASSIGN:
+                compoundAssign(node, result);
+                return;
+
+            case NodeType::PRINT:
+                line("plc::print(" + expr(*node.children[0]) + ");");
+                break;
+
+            case NodeType::IF:
+                line("if (" + condition(*node.children[0]) + ") {");
+                nested(*node.children[1], "");
+                line("}");
+                break;
+
+            case NodeType::WHILE:
+                if (!result.empty()) line(result + " = 0;");
+                line("while (" + condition(*node.children[0]) + ") {");
+                nested(*node.children[1], result);
+                line("}");
+                return;
+
+            case NodeType::FOR:
+                forLoop(node, result);
+                return;
+
+            case NodeType::DEF:
+                if (inFunction || scopes.size() > 1) {
+                    cerr << "ERROR: Cannot translate 'def' inside a block or function to C++ at line " << at << endl;
+                    failed = true;
+                    return;
+                }
+                function(node);
+                break;
+
+            case NodeType::BLOCK:
+                line("{");
+                nested(node, result);
+                line("}");
+                return;
+
+            default:
+                if (!result.empty()) {
+                    line(result + " = " + valueExpr(node) + ";");
+                } else if (!pure(node)) {
+                    line(valueExpr(node) + ";");
+                }
+                return;
+        }
+        if (!result.empty()) line(result + " = 0;");
+    }
+
+    void assign(const Node& node, const string& result) {
+        const string at = lineOf(node);
+        if (node.children.size() < 2) {
+            if (!result.empty()) line(result + " = 0;");
+            return;
+        }
+        const Node& target = *node.children[0];
+        const Node& value = *node.children[1];
+
+        if (target.type == NodeType::VARIABLE) {
+            // The right side is translated first: it cannot see a variable this statement declares
+            const Variable* variable = find(target.value);
+            if (variable) {
+                line(variable->cpp + " = " + (variable->isInt ? intExpr(value, false) : valueExpr(value)) + ";");
+            } else {
+                const bool asInt = intNames.count(target.value) > 0;
+                const string text = asInt ? intExpr(value, false) : valueExpr(value);
+                variable = &declare(target.value);
+                line((asInt ? "int " : "plc::Value ") + variable->cpp + " = " + text + ";");
+            }
+            if (!result.empty()) line(result + " = " + variable->cpp + ";");
+            return;
+        }
+
+        // Element assignment: the value is computed before the index, then the element is replaced in place
+        const string store = result.empty() ? "" : result + " = ";
+        const Node& base = *target.children[0];
+        if (base.type == NodeType::INDEX) {
+            const Variable* matrix =
+                base.children[0]->type == NodeType::VARIABLE ? find(base.children[0]->value) : nullptr;
+            line("{");
+            depth++;
+            line("const plc::Value value = " + valueExpr(value) + ";");
+            if (matrix && !matrix->isInt) {
+                line(store + "plc::setCell(" + matrix->cpp + ", plc::Values{" + valueExpr(*base.children[1]) + ", " +
+                     valueExpr(*target.children[1]) + "}, value, " + at + ");");
+            } else {
+                line("std::cerr << \"ERROR: Cannot assign to non-variable expression\" << std::endl;");
+                if (!result.empty()) line(result + " = 0;");
+            }
+            depth--;
+            line("}");
+            return;
+        }
+
+        const Variable* array = find(base.value);
+        const Node& index = *target.children[1];
+        if (array && !array->isInt && (pure(value) || pure(index))) {
+            line(store + "plc::setAt(" + array->cpp + ", " + quoted(base.value) + ", " + expr(index) + ", " +
+                 valueExpr(value) + ", " + at + ");");
+            return;
+        }
+        line("{");
+        depth++;
+        line("const plc::Value value = " + valueExpr(value) + ";");
+        if (!array) {
+            line(store + "plc::error(" + quoted("Variable '" + base.value + "' not found") + ", " + at + ");");
+        } else if (array->isInt) {
+            line(store + "plc::error(" + quoted("'" + base.value + "' is not an array") + ", " + at + ");");
+        } else {
+            line(store + "plc::setAt(" + array->cpp + ", " + quoted(base.value) + ", " + expr(index) + ", value, " +
+                 at + ");");
+        }
+        depth--;
+        line("}");
+    }
+
+    void compoundAssign(const Node& node, const string& result) {
+        const string at = lineOf(node);
+        const string op = quoted(node.token.value);
+        const string store = result.empty() ? "" : result + " = ";
+        const Node& target = *node.children[0];
+        const Node& operand = *node.children[1];
+        const Node& base = target.type == NodeType::INDEX ? *target.children[0] : target;
+
+        if (base.type == NodeType::INDEX) {
+            const Variable* matrix =
+                base.children[0]->type == NodeType::VARIABLE ? find(base.children[0]->value) : nullptr;
+            line("{");
+            depth++;
+            line("const plc::Value operand = " + valueExpr(operand) + ";");
+            if (matrix && !matrix->isInt) {
+                line(store + "plc::compoundCell(" + op + ", " + matrix->cpp + ", plc::Values{" +
+                     valueExpr(*base.children[1]) + ", " + valueExpr(*target.children[1]) + "}, operand, " + at +
+                     ");");
+            } else {
+                line(store + "plc::error(\"Invalid assignment target\", " + at + ");");
+            }
+            depth--;
+            line("}");
+            return;
+        }
+
+        const Variable* variable = base.type == NodeType::VARIABLE ? find(base.value) : nullptr;
+        if (!variable) {
+            if (!pure(operand)) line(valueExpr(operand) + ";");
+            const string message = base.type == NodeType::VARIABLE ? "Variable '" + base.value + "' not found"
+                                                                   : "Invalid assignment target";
+            line(store + "plc::error(" + quoted(message) + ", " + at + ");");
+            return;
+        }
+
+        if (target.type == NodeType::INDEX) {
+            const Node& index = *target.children[1];
+            if (!variable->isInt && (pure(operand) || pure(index))) {
+                line(store + "plc::compoundAt(" + op + ", " + variable->cpp + ", " + quoted(base.value) + ", " +
+                     expr(index) + ", " + valueExpr(operand) + ", " + at + ");");
+                return;
+            }
+            line("{");
+            depth++;
+            line("const plc::Value operand = " + valueExpr(operand) + ";");
+            if (variable->isInt) {
+                line(store + "plc::error(" + quoted("'" + base.value + "' is not an array") + ", " + at + ");");
+            } else {
+                line(store + "plc::compoundAt(" + op + ", " + variable->cpp + ", " + quoted(base.value) + ", " +
+                     expr(index) + ", operand, " + at + ");");
+            }
+            depth--;
+            line("}");
+            return;
+        }
+
+        if (!variable->isInt) {
+            line(store + "plc::compound(" + op + ", " + variable->cpp + ", " + valueExpr(operand) + ", " + at + ");");
+            return;
+        }
+        if (!isInt(operand)) {
+            // Only reachable when the operand is not an int, which the runtime reports without changing the variable
+            line("{");
+            depth++;
+            line("plc::Value current = " + variable->cpp + ";");
+            line("plc::compound(" + op + ", current, " + valueExpr(operand) + ", " + at + ");");
+            line(variable->cpp + " = current.asInt();");
+            depth--;
+            line("}");
+        } else if (node.value == "/") {
+            line(variable->cpp + " = plc::apply(\"/\", plc::Ints{" + variable->cpp + ", " + intExpr(operand) + "}, " +
+                 at + ");");
+        } else {
+            line(variable->cpp + " " + node.value + "= " + intExpr(operand, false) + ";");
+        }
+        if (!result.empty()) line(result + " = " + variable->cpp + ";");
+    }
+
+    /**
+     * The bounds are evaluated once before the loop variable is declared, and the loop counts in a separate long
+     * long so assigning the variable inside the body cannot change the number of iterations
+     */
+    void forLoop(const Node& node, const string& result) {
+        const string at = lineOf(node);
+        const string start = temporary("start");
+        const string end = temporary("end");
+        const string step = temporary("step");
+        line("const int " + start + " = " + intExpr(*node.children[0], false) + ";");
+        line("const int " + end + " = " + intExpr(*node.children[1], false) + ";");
+        line("const int " + step + " = " + intExpr(*node.children[2], false) + ";");
+        if (!result.empty()) line(result + " = 0;");
+
+        const Variable* variable = find(node.value);
+        if (!variable) {
+            variable = &declare(node.value);
+            line((variable->isInt ? "int " : "plc::Value ") + variable->cpp + " = " + start + ";");
+        } else {
+            line(variable->cpp + " = " + start + ";");
+        }
+
+        // A literal step fixes the direction of the comparison
+        const string counter = temporary("i");
+        const Node& stepNode = *node.children[2];
+        string test;
+        if (stepNode.type == NodeType::NUMBER && stepNode.number != 0) {
+            test = counter + (stepNode.number > 0 ? " < " : " > ") + end;
+        } else {
+            line("if (" + step + " == 0) plc::error(\"range() step must not be 0\", " + at + ");");
+            test = step + " > 0 ? " + counter + " < " + end + " : " + step + " < 0 && " + counter + " > " + end;
+        }
+        line("for (long long " + counter + " = " + start + "; " + test + "; " + counter + " += " + step + ") {");
+        depth++;
+        line(variable->cpp + " = static_cast<int>(" + counter + ");");
+        depth--;
+        nested(*node.children[3], result);
+        line("}");
+    }
+
+    void function(const Node& def) {
+        const string& name = def.value;
+        const int count = ++definitionCount[name];
+        Function compiled{"f_" + name + (count > 1 ? "_" + to_string(count) : ""), &def, {}};
+        const Node& body = *def.children.back();
+
+        Names assigned, notInt;
+        collectTypes(body, assigned, notInt);
+
+        // Save the top-level state; the function is translated into `definitions` with only its parameters in scope
+        auto savedScopes = move(scopes);
+        Names savedInts = move(intNames);
+        ostringstream* savedOut = out;
+        const int savedDepth = depth;
+        scopes.assign(1, {});
+        intNames.clear();
+        for (const auto& local : assigned) {
+            if (!notInt.count(local)) intNames.insert(local);
+        }
+
+        string params;
+        for (size_t i = 0; i + 1 < def.children.size(); i++) {
+            const string& param = def.children[i]->value;
+            // A parameter may only be an int if nothing but ints reach it, and its reads are all proven int
+            const bool paramIsInt = !notInt.count(param) && !assigned.count(param);
+            if (paramIsInt) intNames.insert(param);
+            else intNames.erase(param);
+            compiled.intParams.push_back(paramIsInt);
+            params += (i > 0 ? ", " : "") + string(paramIsInt ? "int " : "plc::Value ") + declare(param).cpp;
+        }
+
+        out = &definitions;
+        depth = 0;
+        inFunction = true;
+        line("plc::Value " + compiled.cpp + "(" + params + ") {");
+        depth = 1;
+        scopes.emplace_back();
+        const bool returns = !body.children.empty() &&
+                             any_of(body.children.begin(), body.children.end(),
+                                    [](const unique_ptr<Node>& child) { return child->type == NodeType::RETURN; });
+        if (!returns) line("plc::Value result = 0;");
+        statements(body.children, returns ? "" : "result", true);
+        if (!returns) line("return result;");
+        depth = 0;
+        line("}");
+        line("");
+
+        inFunction = false;
+        out = savedOut;
+        depth = savedDepth;
+        scopes = move(savedScopes);
+        intNames = move(savedInts);
+        functions[name] = compiled;
+    }
+};
+}  // namespace
+
+bool emitCpp(const Node& program, ostream& out) {
+    if (const Node* broken = findMissingChild(program)) {
+        cerr << "ERROR: Cannot translate a script with syntax errors to C++, see line " << lineOf(*broken) << endl;
+        return false;
+    }
+    Emitter emitter;
+    emitter.program(program);
+    if (emitter.failed) return false;
+
+    out << "// Generated by `main --emit-cpp`. Build with: g++ -std=c++17 -O2 -I src/codegen <this file>\n";
+    out << "#include \"plc_runtime.hpp\"\n\n";
+    out << emitter.definitions.str();
+    out << "int main() {\n" << emitter.mainBody.str() << "}\n";
+    return true;
+}
+}  // namespace codegen
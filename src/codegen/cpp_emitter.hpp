@@ -0,0 +1,21 @@
+#pragma once
+#include <ostream>
+
+#include "src/parser/parser.hpp"
+
+/**
+ * Ahead-of-time translation of compiled scripts to C++. Variables that type inference proved int-only become `int`
+ * locals and everything else a `plc::Value` from plc_runtime.hpp, so the output builds into a standalone binary with
+ *
+ *   g++ -std=c++17 -O2 -I src/codegen script.cpp -o script
+ *
+ * and behaves like running the script with `main`, including its error messages and "Script returned" line.
+ */
+namespace codegen {
+/**
+ * Writes the translation of `program`, which must have been through executor::compile so its nodes carry static
+ * types. Returns false after reporting a construct that has no translation, or a syntax error the parser left a
+ * gap in the tree for; nothing useful is written then.
+ */
+bool emitCpp(const Node& program, std::ostream& out);
+}  // namespace codegen
@@ -0,0 +1,504 @@
+#pragma once
+/**
+ * Runtime for programs translated by `main --emit-cpp`. It is self-contained so generated code builds with only this
+ * header on the include path: `g++ -std=c++17 -O2 -I src/codegen script.cpp`. Values, printing and error messages
+ * follow the interpreter so a translated script produces the same output.
+ */
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace plc {
+struct Value;
+using Array = std::vector<Value>;
+
+// Row-major integer matrix
+struct Matrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> cells;
+
+    Matrix() = default;
+    Matrix(int rows, int cols) : rows(rows), cols(cols), cells(size_t(rows) * cols, 0) {}
+    bool contains(int r, int c) const { return r >= 0 && r < rows && c >= 0 && c < cols; }
+    int& at(int r, int c) { return cells[size_t(r) * cols + c]; }
+    int at(int r, int c) const { return cells[size_t(r) * cols + c]; }
+};
+
+struct Value {
+    std::variant<int, Array, Matrix> v;
+
+    Value(int value = 0) : v(value) {}
+    Value(Array values) : v(std::move(values)) {}
+    Value(Matrix matrix) : v(std::move(matrix)) {}
+
+    bool isInt() const { return std::holds_alternative<int>(v); }
+    bool isArray() const { return std::holds_alternative<Array>(v); }
+    bool isMatrix() const { return std::holds_alternative<Matrix>(v); }
+    int asInt() const { return std::get<int>(v); }
+    Array& asArray() { return std::get<Array>(v); }
+    const Array& asArray() const { return std::get<Array>(v); }
+    Matrix& asMatrix() { return std::get<Matrix>(v); }
+    const Matrix& asMatrix() const { return std::get<Matrix>(v); }
+};
+
+// Operands of a binary operator. Braced initializers run left to right, so `apply("+", {f(), g()}, line)` calls f
+// before g just like the interpreter does
+struct Ints {
+    int left, right;
+};
+struct Values {
+    Value left, right;
+};
+
+inline Value error(const std::string& message, int line) {
+    std::cerr << "ERROR: " << message << " at line " << line << std::endl;
+    return 0;
+}
+
+/**
+ * PRINT output, batched like the interpreter's OutputBuffer and flushed before the result line
+ */
+class Output {
+   private:
+    std::string buffer;
+
+   public:
+    ~Output() { flush(); }
+    void write(const std::string& text) {
+        buffer += text;
+        if (buffer.size() >= 64 * 1024) flush();
+    }
+    void flush() {
+        fwrite(buffer.data(), 1, buffer.size(), stdout);
+        fflush(stdout);
+        buffer.clear();
+    }
+};
+
+inline Output& output() {
+    static Output instance;
+    return instance;
+}
+
+inline int toInt(const Value& value, int line) {
+    if (value.isInt()) return value.asInt();
+    error("Expected an int but got an array", line);
+    return 0;
+}
+
+inline int apply(const char* op, Ints operands, int line) {
+    const int left = operands.left;
+    const int right = operands.right;
+    switch (op[0]) {
+        case '+':
+            return left + right;
+        case '-':
+            return left - right;
+        case '*':
+            return left * right;
+        case '/':
+            if (right == 0) {
+                error("Division by zero", line);
+                return 0;
+            }
+            return left / right;
+        case '=':
+            return left == right;
+        case '<':
+            return left < right;
+        case '>':
+            return left > right;
+    }
+    return 0;
+}
+
+inline Value elementwise(const char* op, const Value& left, const Value& right, int line) {
+    if (op[1] != '\0' || std::string("+-*/").find(op[0]) == std::string::npos) {
+        return error(std::string("Invalid Operation of Matrix '") + op + "'", line);
+    }
+    if (left.isMatrix() && right.isMatrix() &&
+        (left.asMatrix().rows != right.asMatrix().rows || left.asMatrix().cols != right.asMatrix().cols)) {
+        const Matrix& a = left.asMatrix();
+        const Matrix& b = right.asMatrix();
+        return error("Matrix shapes " + std::to_string(a.rows) + "x" + std::to_string(a.cols) + " and " +
+                         std::to_string(b.rows) + "x" + std::to_string(b.cols) + " do not match for '" + op + "'",
+                     line);
+    }
+    if (!(left.isMatrix() || left.isInt()) || !(right.isMatrix() || right.isInt())) {
+        return error(std::string("Invalid Operation of Array '") + op + "'", line);
+    }
+    Matrix result = left.isMatrix() ? left.asMatrix() : right.asMatrix();
+    for (size_t i = 0; i < result.cells.size(); i++) {
+        const int a = left.isMatrix() ? left.asMatrix().cells[i] : left.asInt();
+        const int b = right.isMatrix() ? right.asMatrix().cells[i] : right.asInt();
+        if (op[0] == '/' && b == 0) return error("Division by zero", line);
+        result.cells[i] = apply(op, {a, b}, line);
+    }
+    return result;
+}
+
+inline Value apply(const char* op, const Values& operands, int line) {
+    const Value& left = operands.left;
+    const Value& right = operands.right;
+    if (left.isInt() && right.isInt()) return apply(op, Ints{left.asInt(), right.asInt()}, line);
+    const bool comparison = op[0] == '=' || op[0] == '<' || op[0] == '>';
+    if (comparison) return error(std::string("Invalid Comparison of Array '") + op + "'", line);
+    if (left.isMatrix() || right.isMatrix()) return elementwise(op, left, right, line);
+    return error(std::string("Invalid Operation of Array '") + op + "'", line);
+}
+
+// `base[i]`: an array element, or a copy of row i of a matrix
+inline Value index(const Value& base, int i, int line) {
+    if (base.isMatrix()) {
+        const Matrix& m = base.asMatrix();
+        if (!m.contains(i, 0)) return error("Matrix index out of bounds", line);
+        return Array(m.cells.begin() + size_t(i) * m.cols, m.cells.begin() + size_t(i + 1) * m.cols);
+    }
+    if (!base.isArray()) return error("Cannot index an int", line);
+    const Array& values = base.asArray();
+    if (i < 0 || size_t(i) >= values.size()) return error("Array index out of bounds", line);
+    return values[i];
+}
+
+inline Value index(const Value& base, const Value& i, int line) { return index(base, toInt(i, line), line); }
+
+// `base[i]` where an int is expected, without building a Value for the element
+inline int intAt(const Value& base, int i, int line) {
+    if (base.isArray() && i >= 0 && size_t(i) < base.asArray().size() && base.asArray()[i].isInt()) {
+        return base.asArray()[i].asInt();
+    }
+    return toInt(index(base, i, line), line);
+}
+
+inline int intAt(const Value& base, const Value& i, int line) { return intAt(base, toInt(i, line), line); }
+
+// `m[r][c]` read straight from the matrix, falling back to nested arrays
+inline Value cell(const Value& base, Ints cell, int line) {
+    if (!base.isMatrix()) return index(index(base, cell.left, line), cell.right, line);
+    const Matrix& m = base.asMatrix();
+    if (!m.contains(cell.left, cell.right)) return error("Matrix index out of bounds", line);
+    return m.at(cell.left, cell.right);
+}
+
+inline Value setAt(Value& base, const char* name, int i, const Value& value, int line) {
+    if (!base.isArray()) return error(std::string("'") + name + "' is not an array", line);
+    Array& values = base.asArray();
+    if (i < 0 || size_t(i) >= values.size()) return error("Array index out of bounds", line);
+    values[i] = value;
+    return value;
+}
+
+inline Value setAt(Value& base, const char* name, const Value& i, const Value& value, int line) {
+    if (base.isArray() && !i.isInt()) return error("Array index must be an integer", line);
+    return setAt(base, name, i.isInt() ? i.asInt() : 0, value, line);
+}
+
+inline Value setCell(Value& base, const Values& cell, const Value& value, int line) {
+    if (!base.isMatrix()) {
+        std::cerr << "ERROR: Cannot assign to non-variable expression" << std::endl;
+        return 0;
+    }
+    Matrix& m = base.asMatrix();
+    const Value& r = cell.left;
+    const Value& c = cell.right;
+    if (!r.isInt() || !c.isInt() || !m.contains(r.asInt(), c.asInt())) return error("Matrix index out of bounds", line);
+    if (!value.isInt()) return error("Matrix elements must be integers", line);
+    m.at(r.asInt(), c.asInt()) = value.asInt();
+    return value;
+}
+
+// `target op= operand` on a variable holding any value. `op` is the compound token, such as "+="
+inline Value compound(const char* op, Value& target, const Value& operand, int line) {
+    if (!target.isInt() || !operand.isInt()) return error(std::string("Invalid Operation of Array '") + op + "'", line);
+    const char arithmetic[] = {op[0], '\0'};
+    target = apply(arithmetic, Ints{target.asInt(), operand.asInt()}, line);
+    return target;
+}
+
+inline Value compoundAt(const char* op, Value& base, const char* name, int i, const Value& operand, int line) {
+    if (!base.isArray()) return error(std::string("'") + name + "' is not an array", line);
+    Array& values = base.asArray();
+    if (i < 0 || size_t(i) >= values.size()) return error("Array index out of bounds", line);
+    return compound(op, values[i], operand, line);
+}
+
+inline Value compoundAt(const char* op, Value& base, const char* name, const Value& i, const Value& operand,
+                        int line) {
+    if (base.isArray() && !i.isInt()) return error("Array index must be an integer", line);
+    return compoundAt(op, base, name, i.isInt() ? i.asInt() : 0, operand, line);
+}
+
+inline Value compoundCell(const char* op, Value& base, const Values& cell, const Value& operand, int line) {
+    if (!base.isMatrix()) return error("Invalid assignment target", line);
+    Matrix& m = base.asMatrix();
+    const Value& r = cell.left;
+    const Value& c = cell.right;
+    if (!r.isInt() || !c.isInt() || !m.contains(r.asInt(), c.asInt())) return error("Matrix index out of bounds", line);
+    if (!operand.isInt()) return error("Matrix elements must be integers", line);
+    int& current = m.at(r.asInt(), c.asInt());
+    const char arithmetic[] = {op[0], '\0'};
+    current = apply(arithmetic, Ints{current, operand.asInt()}, line);
+    return current;
+}
+
+inline void print(int value) { output().write(std::to_string(value) + "\n"); }
+
+inline void print(const Value& value) {
+    std::string text;
+    if (value.isInt()) {
+        text = std::to_string(value.asInt()) + "\n";
+    } else if (value.isArray()) {
+        text = "[";
+        const Array& values = value.asArray();
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i > 0) text += ",";
+            text += std::to_string(values[i].isInt() ? values[i].asInt() : 0);
+        }
+        text += "]\n";
+    } else {
+        const Matrix& m = value.asMatrix();
+        for (int r = 0; r < m.rows; r++) {
+            text += "[";
+            for (int c = 0; c < m.cols; c++) {
+                if (c > 0) text += ",";
+                text += std::to_string(m.at(r, c));
+            }
+            text += "]\n";
+        }
+    }
+    output().write(text);
+}
+
+// Reports the script's result the way `main` does and returns the process exit code
+inline int finish(const Value& result) {
+    output().flush();
+    if (result.isArray()) {
+        std::cout << "Script returned array of size " << result.asArray().size();
+    } else if (result.isMatrix()) {
+        std::cout << "Script returned " << result.asMatrix().rows << "x" << result.asMatrix().cols << " matrix";
+    } else {
+        std::cout << "Script returned " << result.asInt();
+    }
+    std::cout.flush();
+    return result.isInt() ? result.asInt() : 0;
+}
+
+/**
+ * The builtin natives. Arguments are checked before anything runs, with the interpreter's messages
+ */
+namespace natives {
+inline bool check(bool accepted, int position, const char* name, const char* expected, int line) {
+    if (!accepted) {
+        error("Argument " + std::to_string(position) + " of '" + name + "' must be " + expected, line);
+    }
+    return accepted;
+}
+
+inline bool ints(const Value& value, const char* name, int line) {
+    for (const Value& element : value.asArray()) {
+        if (!element.isInt()) {
+            error(std::string(name) + "() needs an array of ints", line);
+            return false;
+        }
+    }
+    return true;
+}
+
+inline Value sort(Value& values, int line) {
+    if (!check(values.isArray(), 1, "sort", "an array", line) || !ints(values, "sort", line)) return 0;
+    Array& elements = values.asArray();
+    std::sort(elements.begin(), elements.end(), [](const Value& a, const Value& b) { return a.asInt() < b.asInt(); });
+    return 0;
+}
+
+// sort() of a temporary still checks its argument, and the sorted copy is dropped
+inline Value sort(Value&& values, int line) { return sort(values, line); }
+
+inline Value sum(const Value& values, int line) {
+    if (!check(values.isArray(), 1, "sum", "an array", line) || !ints(values, "sum", line)) return 0;
+    long long total = 0;
+    for (const Value& element : values.asArray()) total += element.asInt();
+    return static_cast<int>(total);
+}
+
+inline Value extreme(const Value& values, const char* name, bool wantMax, int line) {
+    if (!check(values.isArray(), 1, name, "an array", line)) return 0;
+    if (values.asArray().empty()) return error(std::string(name) + "() of an empty array", line);
+    if (!ints(values, name, line)) return 0;
+    int best = wantMax ? INT_MIN : INT_MAX;
+    for (const Value& element : values.asArray()) {
+        best = wantMax ? std::max(best, element.asInt()) : std::min(best, element.asInt());
+    }
+    return best;
+}
+
+inline Value min(const Value& values, int line) { return extreme(values, "min", false, line); }
+inline Value max(const Value& values, int line) { return extreme(values, "max", true, line); }
+
+inline Value find(const Value& values, const Value& x, int line) {
+    if (!check(values.isArray(), 1, "find", "an array", line) || !check(x.isInt(), 2, "find", "an int", line)) return 0;
+    const Array& elements = values.asArray();
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (elements[i].isInt() && elements[i].asInt() == x.asInt()) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+inline Value count(const Value& values, const Value& x, int line) {
+    if (!check(values.isArray(), 1, "count", "an array", line) || !check(x.isInt(), 2, "count", "an int", line)) {
+        return 0;
+    }
+    int matches = 0;
+    for (const Value& element : values.asArray()) {
+        if (element.isInt() && element.asInt() == x.asInt()) matches++;
+    }
+    return matches;
+}
+
+inline Value matrix(const Value& rows, const Value& cols, int line) {
+    if (!check(rows.isInt(), 1, "matrix", "an int", line) || !check(cols.isInt(), 2, "matrix", "an int", line)) {
+        return 0;
+    }
+    if (rows.asInt() < 0 || cols.asInt() < 0) return error("matrix() dimensions must not be negative", line);
+    return Matrix(rows.asInt(), cols.asInt());
+}
+
+inline Value rows(const Value& m, int line) {
+    return check(m.isMatrix(), 1, "rows", "a matrix", line) ? m.asMatrix().rows : 0;
+}
+
+inline Value cols(const Value& m, int line) {
+    return check(m.isMatrix(), 1, "cols", "a matrix", line) ? m.asMatrix().cols : 0;
+}
+
+inline Value transpose(const Value& value, int line) {
+    if (!check(value.isMatrix(), 1, "transpose", "a matrix", line)) return 0;
+    const Matrix& m = value.asMatrix();
+    Matrix result(m.cols, m.rows);
+    for (int r = 0; r < m.rows; r++) {
+        for (int c = 0; c < m.cols; c++) result.at(c, r) = m.at(r, c);
+    }
+    return result;
+}
+
+inline Value matmul(const Value& left, const Value& right, int line) {
+    if (!check(left.isMatrix(), 1, "matmul", "a matrix", line) ||
+        !check(right.isMatrix(), 2, "matmul", "a matrix", line)) {
+        return 0;
+    }
+    const Matrix& a = left.asMatrix();
+    const Matrix& b = right.asMatrix();
+    if (a.cols != b.rows) {
+        return error("matmul() of " + std::to_string(a.rows) + "x" + std::to_string(a.cols) + " and " +
+                         std::to_string(b.rows) + "x" + std::to_string(b.cols) + " matrices",
+                     line);
+    }
+    Matrix result(a.rows, b.cols);
+    for (int i = 0; i < a.rows; i++) {
+        int* out = &result.cells[size_t(i) * b.cols];
+        for (int k = 0; k < a.cols; k++) {
+            const int scale = a.at(i, k);
+            const int* in = &b.cells[size_t(k) * b.cols];
+            for (int j = 0; j < b.cols; j++) out[j] += scale * in[j];
+        }
+    }
+    return result;
+}
+
+// Arguments that must be string literals arrive as the literal, anything else as nullptr once evaluated
+inline const char* notString(const Value&) { return nullptr; }
+
+inline Value load_ints(const char* path, int line) {
+    if (!check(path != nullptr, 1, "load_ints", "a string", line)) return 0;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return error(std::string("load_ints() cannot open '") + path + "'", line);
+    std::vector<char> bytes;
+    char chunk[1 << 16];
+    while (file.read(chunk, sizeof chunk) || file.gcount() > 0) bytes.insert(bytes.end(), chunk, chunk + file.gcount());
+    if (bytes.size() % 4 != 0) {
+        return error(std::string("load_ints() size of '") + path + "' is not a multiple of 4 bytes", line);
+    }
+    Array values;
+    values.reserve(bytes.size() / 4);
+    for (size_t i = 0; i < bytes.size(); i += 4) {
+        const auto* b = reinterpret_cast<const unsigned char*>(&bytes[i]);
+        values.emplace_back(
+            static_cast<int>(uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24));
+    }
+    return values;
+}
+
+inline Value load_csv_ints(const char* path, const Value& column, int line) {
+    if (!check(path != nullptr, 1, "load_csv_ints", "a string", line) ||
+        !check(column.isInt(), 2, "load_csv_ints", "an int", line)) {
+        return 0;
+    }
+    const int wanted = column.asInt();
+    if (wanted < 0) return error("load_csv_ints() column must not be negative", line);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return error(std::string("load_csv_ints() cannot open '") + path + "'", line);
+
+    auto blank = [](char c) { return c == ' ' || c == '\t'; };
+    Array values;
+    bool firstRow = true;
+    int lineNumber = 0;
+    for (std::string text; std::getline(file, text);) {
+        lineNumber++;
+        if (!text.empty() && text.back() == '\r') text.pop_back();
+        if (std::all_of(text.begin(), text.end(), blank)) continue;
+
+        size_t begin = 0;
+        for (int skipped = 0; begin != std::string::npos && skipped < wanted; skipped++) {
+            begin = text.find(',', begin);
+            if (begin != std::string::npos) begin++;
+        }
+        if (begin == std::string::npos) {
+            return error("load_csv_ints() line " + std::to_string(lineNumber) + " of '" + path + "' has no column " +
+                             std::to_string(wanted),
+                         line);
+        }
+        size_t end = std::min(text.find(',', begin), text.size());
+        while (begin < end && blank(text[begin])) begin++;
+        while (end > begin && blank(text[end - 1])) end--;
+
+        int value = 0;
+        const auto parsed = std::from_chars(text.data() + begin, text.data() + end, value);
+        if (parsed.ec == std::errc() && parsed.ptr == text.data() + end && begin < end) {
+            values.emplace_back(value);
+        } else if (!firstRow) {
+            return error("load_csv_ints() line " + std::to_string(lineNumber) + " of '" + path + "' column " +
+                             std::to_string(wanted) + " is not an int",
+                         line);
+        }
+        firstRow = false;
+    }
+    return values;
+}
+
+inline Value save_ints(const Value& values, const char* path, int line) {
+    if (!check(values.isArray(), 1, "save_ints", "an array", line) ||
+        !check(path != nullptr, 2, "save_ints", "a string", line) || !ints(values, "save_ints", line)) {
+        return 0;
+    }
+    std::string bytes;
+    for (const Value& element : values.asArray()) {
+        const uint32_t bits = static_cast<uint32_t>(element.asInt());
+        for (int i = 0; i < 4; i++) bytes.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.write(bytes.data(), bytes.size()) || !file.flush()) {
+        return error(std::string("save_ints() cannot write '") + path + "'", line);
+    }
+    return static_cast<int>(values.asArray().size());
+}
+}  // namespace natives
+}  // namespace plc
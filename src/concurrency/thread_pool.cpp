@@ -0,0 +1,141 @@
+#include "src/concurrency/thread_pool.hpp"
+
+#include <chrono>
+
+using namespace std;
+
+namespace {
+// Identifies the pool and deque owned by the calling thread so nested submissions stay local
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = SIZE_MAX;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) threadCount = 1;
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.push_back(make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Process wide pool sized to the hardware, created on first use
+ */
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+/**
+ * Queues a task. Workers push onto their own deque, other threads spread tasks round-robin
+ */
+void ThreadPool::submit(function<void()> task) {
+    size_t target = (currentPool == this) ? currentWorker : nextWorker++ % workers.size();
+    {
+        lock_guard<mutex> lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(move(task));
+    }
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        ++pending;
+    }
+    wake.notify_one();
+}
+
+/**
+ * Runs task(0) .. task(taskCount - 1) across the pool and blocks until all have finished.
+ * The calling thread runs tasks too, so this is safe to call from inside a worker.
+ */
+void ThreadPool::parallelFor(size_t taskCount, const function<void(size_t)>& task) {
+    if (taskCount == 0) return;
+    if (taskCount == 1) {
+        task(0);
+        return;
+    }
+
+    struct Latch {
+        atomic<size_t> remaining;
+        mutex doneMutex;
+        condition_variable done;
+    };
+    auto latch = make_shared<Latch>();
+    latch->remaining = taskCount;
+
+    auto finish = [](const shared_ptr<Latch>& l) {
+        lock_guard<mutex> lock(l->doneMutex);
+        if (--l->remaining == 0) l->done.notify_all();
+    };
+
+    for (size_t i = 1; i < taskCount; i++) {
+        submit([latch, &task, finish, i] {
+            task(i);
+            finish(latch);
+        });
+    }
+    task(0);
+    finish(latch);
+
+    // Help drain the queues instead of idling while the other chunks run
+    size_t self = (currentPool == this) ? currentWorker : SIZE_MAX;
+    while (latch->remaining.load() > 0) {
+        if (!runOne(self)) {
+            unique_lock<mutex> lock(latch->doneMutex);
+            latch->done.wait_for(lock, chrono::milliseconds(1), [&] { return latch->remaining.load() == 0; });
+        }
+    }
+}
+
+void ThreadPool::workerLoop(size_t self) {
+    currentPool = this;
+    currentWorker = self;
+    while (true) {
+        if (runOne(self)) continue;
+
+        unique_lock<mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || pending.load() > 0; });
+        if (stopping && pending.load() == 0) return;
+    }
+}
+
+/**
+ * Pops a task from our own deque (newest first) or steals the oldest task from another worker
+ */
+bool ThreadPool::runOne(size_t self) {
+    function<void()> task;
+    const size_t count = workers.size();
+
+    if (self < count) {
+        lock_guard<mutex> lock(workers[self]->mutex);
+        if (!workers[self]->tasks.empty()) {
+            task = move(workers[self]->tasks.back());
+            workers[self]->tasks.pop_back();
+        }
+    }
+
+    for (size_t offset = 1; !task && offset <= count; offset++) {
+        size_t victim = (self < count ? self + offset : offset) % count;
+        lock_guard<mutex> lock(workers[victim]->mutex);
+        if (!workers[victim]->tasks.empty()) {
+            task = move(workers[victim]->tasks.front());
+            workers[victim]->tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+    --pending;
+    task();
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool. Every worker owns a deque: it pops its own tasks from the back and steals from the
+ * front of the other workers' deques when it runs dry.
+ */
+class ThreadPool {
+   private:
+    struct Worker {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextWorker{0};
+    bool stopping = false;
+
+   public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& shared();
+
+    size_t size() const { return threads.size(); }
+    void submit(std::function<void()> task);
+    void parallelFor(size_t taskCount, const std::function<void(size_t)>& task);
+
+   private:
+    void workerLoop(size_t self);
+    bool runOne(size_t self);
+};
@@ -1,8 +1,17 @@
 #include "src/executor/executor.hpp"
 
+#include <chrono>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <mutex>
+
+#include "src/concurrency/thread_pool.hpp"
 #include "src/interpreter/interpreter.hpp"
 #include "src/lexer/lexer.hpp"
+#include "src/optimizer/optimizer.hpp"
 #include "src/parser/parser.hpp"
+#include "src/snapshot/snapshot.hpp"
 #include "src/utility/utility.hpp"
 
 
@@ -10,18 +19,292 @@ using namespace std;
 
 namespace executor {
 
-Value executeFile(std::string filePath) {
-    string fileContents = utility::readFile(filePath);
-    string fileContentsFormatted = utility::convertTabs(fileContents);
+namespace {
+/**
+ * Interpreters handed out by run(). They are reset on release so no state leaks between programs
+ */
+class InterpreterPool {
+   private:
+    mutex poolMutex;
+    vector<unique_ptr<Interpreter>> idle;
+
+   public:
+    unique_ptr<Interpreter> acquire() {
+        lock_guard<mutex> lock(poolMutex);
+        if (idle.empty()) return make_unique<Interpreter>();
+        auto interpreter = move(idle.back());
+        idle.pop_back();
+        return interpreter;
+    }
 
-    auto lexer = make_unique<Lexer>();
-    auto tokens = lexer->tokenize(fileContentsFormatted);
+    void release(unique_ptr<Interpreter> interpreter) {
+        interpreter->reset();
+        lock_guard<mutex> lock(poolMutex);
+        idle.push_back(move(interpreter));
+    }
+};
+
+InterpreterPool& interpreterPool() {
+    static InterpreterPool pool;
+    return pool;
+}
 
-    auto parser = make_unique<Parser>();
-    auto ast = parser->parseProgram(tokens);
+/**
+ * Calls `body` with a pooled interpreter set up for `options`. The interpreter goes back to the pool even when
+ * evaluation throws
+ */
+template <class Body>
+Value withInterpreter(const RunOptions& options, Body body) {
+    auto interpreter = interpreterPool().acquire();
+    interpreter->printBuffer.setSink(*options.output);
+    if (options.control) interpreter->control = options.control;
+    interpreter->profile = options.profile;
+    interpreter->shadow = options.shadow;
 
-    auto interpreter = make_unique<Interpreter>();
-    Value result = interpreter->evaluate(ast);
+    ArrayPool& pool = interpreter->arrayPool;
+    const size_t hits = pool.hits();
+    const size_t misses = pool.misses();
+    Value result;
+    try {
+        ArrayPool::Activation pooling(options.pooledArrays ? &pool : nullptr);
+        result = body(*interpreter);
+        if (options.profile) {
+            options.profile->poolHits += pool.hits() - hits;
+            options.profile->poolMisses += pool.misses() - misses;
+        }
+    } catch (...) {
+        interpreterPool().release(move(interpreter));
+        throw;
+    }
+    interpreterPool().release(move(interpreter));
     return result;
 }
+
+Value evaluateProgram(const Program& program, const Bindings& bindings, const RunOptions& options) {
+    return withInterpreter(options, [&](Interpreter& interpreter) {
+        for (const auto& binding : bindings) {
+            interpreter.globalScope.update(binding.first, binding.second);
+        }
+        return interpreter.evaluate(program.ast);
+    });
+}
+
+// Index of the first top-level checkpoint() call, or the number of statements if there is none
+size_t findCheckpoint(const Node& ast) {
+    for (size_t i = 0; i < ast.children.size(); i++) {
+        const Node& statement = *ast.children[i];
+        if (statement.type == NodeType::FUNC_CALL && statement.value == "checkpoint" && statement.children.empty()) {
+            return i;
+        }
+    }
+    return ast.children.size();
+}
+
+// FNV-1a
+uint64_t fingerprintOf(const string& source) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : source) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t countNodes(const Node& node) {
+    size_t count = 1;
+    for (const auto& child : node.children) {
+        if (child) count += countNodes(*child);
+    }
+    return count;
+}
+
+/**
+ * Runs one phase of a script and, when profiling, records its wall time and tracked allocations as `name`
+ */
+template <class Body>
+auto phase(Profile* profile, const char* name, Body body) -> decltype(body()) {
+    if (!profile) return body();
+    MemoryTracker* tracker = MemoryTracker::active();
+    const size_t allocationsBefore = tracker ? tracker->allocationCount() : 0;
+    const auto start = chrono::steady_clock::now();
+
+    auto result = body();
+
+    const auto end = chrono::steady_clock::now();
+    PhaseStats stats{name};
+    stats.milliseconds = chrono::duration<double, milli>(end - start).count();
+    stats.allocations = tracker ? tracker->allocationCount() - allocationsBefore : 0;
+    profile->phases.push_back(stats);
+    if (profile->trace) profile->trace->add(name, "phase", start, end);
+    return result;
+}
+
+shared_ptr<const Program> compileProfiled(const string& source, const CompileOptions& options, Profile* profile) {
+    auto tokens = phase(profile, "lex", [&] {
+        string sourceFormatted = utility::convertTabs(source);
+        auto lexer = make_unique<Lexer>();
+        return lexer->tokenize(sourceFormatted);
+    });
+
+    auto program = make_shared<Program>();
+    program->ast = phase(profile, "parse", [&] {
+        auto parser = make_unique<Parser>();
+        return parser->parseProgram(tokens);
+    });
+    // Snapshots refer to top-level statements by index, which inlining shifts
+    program->fingerprint = fingerprintOf(source) ^ (options.inlineFunctions ? 0 : 1);
+
+    phase(profile, "optimize", [&] {
+        if (options.inlineFunctions) optimizer::inlineFunctions(*program->ast);
+        optimizer::analyzeScopes(*program->ast);
+        // After analyzeScopes, so a block whose only new variables are temporaries still runs without a scope
+        optimizer::eliminateCommonSubexpressions(*program->ast);
+        optimizer::hoistLoopInvariants(*program->ast);
+        optimizer::shareConstantArrays(*program->ast);
+        optimizer::inferTypes(*program->ast);
+        return true;
+    });
+
+    if (profile) {
+        profile->tokens = tokens.size();
+        profile->astNodes = countNodes(*program->ast);
+    }
+    return program;
+}
+
+/**
+ * Calls `body` with a fresh MemoryTracker active on this thread and reports what it used
+ */
+template <class Body>
+RunResult runTracked(size_t memoryBudget, Body body) {
+    MemoryTracker tracker(memoryBudget);
+    MemoryTracker::Activation activation(&tracker);
+
+    RunResult result;
+    try {
+        result.value = body();
+    } catch (const MemoryBudgetExceeded&) {
+        cerr << "ERROR: Script exceeded its memory budget of " << memoryBudget << " bytes" << endl;
+        result.outOfMemory = true;
+    } catch (const ScriptTimeout&) {
+        cerr << "ERROR: Script timed out" << endl;
+        result.timedOut = true;
+    }
+    result.liveBytes = tracker.liveBytes();
+    result.peakBytes = tracker.peakBytes();
+    return result;
+}
+
+/**
+ * Read -> compile -> run for one script with all state local to this call
+ */
+RunResult executeScript(const string& filePath, const RunOptions& options) {
+    return runTracked(options.memoryBudget, [&] {
+        Profile* profile = options.profile;
+        const string source = phase(profile, "read", [&] { return utility::readFile(filePath); });
+        auto program = compileProfiled(source, options.compileOptions, profile);
+        return phase(profile, "evaluate", [&] { return evaluateProgram(*program, {}, options); });
+    });
+}
+}  // namespace
+
+Value executeFile(std::string filePath) { return executeScript(filePath, RunOptions()).value; }
+
+RunResult executeFile(const string& filePath, const RunOptions& options) { return executeScript(filePath, options); }
+
+shared_ptr<const Program> compile(const string& source, const CompileOptions& options) {
+    return compileProfiled(source, options, nullptr);
+}
+
+Value run(const Program& program, const Bindings& bindings, OutputSink& output) {
+    RunOptions options;
+    options.output = &output;
+    return run(program, bindings, options).value;
+}
+
+RunResult run(const Program& program, const Bindings& bindings, const RunOptions& options) {
+    return runTracked(options.memoryBudget, [&] { return evaluateProgram(program, bindings, options); });
+}
+
+bool saveSnapshot(const Program& program, const string& snapshotPath, OutputSink& output) {
+    const Node& ast = *program.ast;
+    const size_t marker = findCheckpoint(ast);
+    if (marker == ast.children.size()) {
+        cerr << "ERROR: Script has no top-level checkpoint() to snapshot at" << endl;
+        return false;
+    }
+
+    RunOptions options;
+    options.output = &output;
+    bool saved = false;
+    withInterpreter(options, [&](Interpreter& interpreter) {
+        for (size_t i = 0; i < marker; i++) {
+            interpreter.evaluate(ast.children[i]);
+            if (ast.children[i]->type == NodeType::RETURN) {
+                cerr << "ERROR: Script returned before reaching checkpoint() at line "
+                     << ast.children[marker]->token.lineNumber << endl;
+                return Value(0);
+            }
+        }
+        saved = snapshot::write(snapshotPath, program.fingerprint, marker + 1, interpreter, ast);
+        return Value(0);
+    });
+    return saved;
+}
+
+RunResult runFromSnapshot(const Program& program, const string& snapshotPath, const RunOptions& options) {
+    return runTracked(options.memoryBudget, [&] {
+        return withInterpreter(options, [&](Interpreter& interpreter) {
+            const Node& ast = *program.ast;
+            const long resumeAt = snapshot::read(snapshotPath, program.fingerprint, interpreter, ast);
+            if (resumeAt < 0) return Value(0);
+            for (size_t i = resumeAt; i < ast.children.size(); i++) {
+                Value value = interpreter.evaluate(ast.children[i]);
+                if (ast.children[i]->type == NodeType::RETURN) return value;
+            }
+            return Value(0);
+        });
+    });
+}
+
+vector<ScriptResult> executeBatch(const vector<string>& paths, size_t threads, size_t memoryBudget) {
+    if (threads == 0) threads = thread::hardware_concurrency();
+    ThreadPool pool(threads);
+
+    vector<ScriptResult> results(paths.size());
+    vector<future<void>> finished;
+    finished.reserve(paths.size());
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        auto done = make_shared<promise<void>>();
+        finished.push_back(done->get_future());
+        pool.submit([&paths, &results, i, done, memoryBudget] {
+            ScriptResult& result = results[i];
+            result.path = paths[i];
+
+            StringSink output;
+            RunOptions options;
+            options.output = &output;
+            options.memoryBudget = memoryBudget;
+
+            const auto start = chrono::steady_clock::now();
+            // One failing script must neither end the batch nor leave its result unfinished
+            try {
+                static_cast<RunResult&>(result) = executeScript(paths[i], options);
+            } catch (const exception& e) {
+                cerr << "ERROR: " << paths[i] << ": " << e.what() << endl;
+                result.error = e.what();
+            }
+            const auto end = chrono::steady_clock::now();
+
+            result.output = move(output.text);
+            result.milliseconds = chrono::duration<double, milli>(end - start).count();
+            done->set_value();
+        });
+    }
+
+    for (auto& f : finished) {
+        f.wait();
+    }
+    return results;
+}
 }  // namespace executor
@@ -1,7 +1,96 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/interpreter/execution_control.hpp"
+#include "src/output/output.hpp"
+#include "src/parser/parser.hpp"
+#include "src/profiling/profile.hpp"
+#include "src/profiling/sampler.hpp"
 #include "src/scope/value.hpp"
 
 namespace executor {
+/**
+ * A parsed script. Programs are never modified after compile, so one Program can be run any number of times from
+ * any number of threads.
+ */
+struct Program {
+    std::unique_ptr<Node> ast;
+    uint64_t fingerprint = 0;  // Hash of the source text, ties snapshots to the script they came from
+};
+
+// Global variables bound before the program starts
+using Bindings = std::unordered_map<std::string, Value>;
+
+struct CompileOptions {
+    bool inlineFunctions = true;  // Copy small functions into their callers
+};
+
+struct RunOptions {
+    OutputSink* output = &OutputSink::standard();
+    CompileOptions compileOptions;        // Used when the run starts from a file
+    size_t memoryBudget = 0;              // Most bytes the script may hold at once, 0 for no limit
+    ExecutionControl* control = nullptr;  // Preemption hook called on loop back-edges
+    Profile* profile = nullptr;           // Filled in with per-phase times and interpreter counters when set
+    ShadowStack* shadow = nullptr;        // Call stack a running Sampler reads
+    bool pooledArrays = true;             // Allocate arrays and scopes from the interpreter's ArrayPool, not malloc
+};
+
+struct RunResult {
+    Value value;
+    size_t liveBytes = 0;  // Arrays, scopes and AST nodes still held when the script finished
+    size_t peakBytes = 0;
+    bool outOfMemory = false;  // The script was stopped for going over its memory budget
+    bool timedOut = false;     // A checkpoint stopped the script with ScriptTimeout
+};
+
+struct ScriptResult : RunResult {
+    std::string path;
+    std::string output;  // Everything the script printed
+    std::string error;   // What the exception that stopped the script said, empty if nothing was thrown
+    double milliseconds = 0;
+};
+
 Value executeFile(std::string filePath);
-}
\ No newline at end of file
+RunResult executeFile(const std::string& filePath, const RunOptions& options);
+
+std::shared_ptr<const Program> compile(const std::string& source, const CompileOptions& options = CompileOptions());
+
+/**
+ * Evaluates a compiled program on a pooled interpreter with `bindings` pre-declared as globals.
+ * Nothing is lexed, parsed or cloned; functions are called straight from the program's AST.
+ * Printed output is buffered and reaches `output` when the buffer fills up and when the run ends.
+ */
+Value run(const Program& program, const Bindings& bindings = {}, OutputSink& output = OutputSink::standard());
+
+/**
+ * Same as above, also measuring the memory the run holds. A run that goes over options.memoryBudget stops with
+ * a script error, a value of 0 and outOfMemory set; one stopped by its control stops the same way with timedOut.
+ */
+RunResult run(const Program& program, const Bindings& bindings, const RunOptions& options);
+
+/**
+ * Runs `program` up to its first top-level checkpoint() call and saves the globals, functions and arrays built so
+ * far to `snapshotPath`. Returns false after reporting why if the script has no checkpoint() or returns before it.
+ */
+bool saveSnapshot(const Program& program, const std::string& snapshotPath,
+                  OutputSink& output = OutputSink::standard());
+
+/**
+ * Maps a snapshot saved by saveSnapshot and runs only the statements after the checkpoint. The program must be
+ * compiled from the same source text the snapshot was taken from.
+ */
+RunResult runFromSnapshot(const Program& program, const std::string& snapshotPath,
+                          const RunOptions& options = RunOptions());
+
+/**
+ * Runs every script on a pool of `threads` workers (0 uses one per core) and returns results in input order.
+ * Each script gets its own lexer, parser and pooled interpreter and prints into its own buffer, so this is safe to call
+ * from several threads at once. Diagnostics still go to std::cerr.
+ */
+std::vector<ScriptResult> executeBatch(const std::vector<std::string>& paths, size_t threads = 0,
+                                       size_t memoryBudget = 0);
+}  // namespace executor
@@ -0,0 +1,140 @@
+#include "src/executor/scheduler.hpp"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+namespace executor {
+/**
+ * One submitted script. It is the script's ExecutionControl, so checkpoints land back in the scheduler.
+ */
+class Scheduler::Task : public ExecutionControl {
+   public:
+    Scheduler& scheduler;
+    int priority;
+    bool hasDeadline;
+    chrono::steady_clock::time_point deadline;
+    condition_variable resumed;
+    bool running = false;
+
+    Task(Scheduler& scheduler, int priority, chrono::milliseconds timeout)
+        : scheduler(scheduler),
+          priority(priority),
+          hasDeadline(timeout.count() > 0),
+          deadline(chrono::steady_clock::now() + timeout) {
+        remaining = scheduler.quantum;
+    }
+
+    void checkpoint() override {
+        remaining = scheduler.quantum;
+        if (hasDeadline && chrono::steady_clock::now() >= deadline) throw ScriptTimeout();
+        scheduler.yield(*this);
+    }
+};
+
+Scheduler::Scheduler(size_t slots, long long quantum)
+    : freeSlots(slots == 0 ? thread::hardware_concurrency() : slots), quantum(quantum > 0 ? quantum : 1) {
+    if (freeSlots == 0) freeSlots = 1;
+}
+
+Scheduler::~Scheduler() {
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+// Joins the threads of finished scripts. Needs the mutex held
+void Scheduler::reapFinished() {
+    for (auto& t : finished) {
+        t->join();
+        threads.erase(t);
+    }
+    finished.clear();
+}
+
+// Blocks until `task` holds a slot. Callers that already waited in line keep their place
+void Scheduler::acquireSlot(Task& task, unique_lock<std::mutex>& lock) {
+    if (freeSlots > 0 && waiting.empty()) {
+        --freeSlots;
+        task.running = true;
+        return;
+    }
+    waiting.push({task.priority, nextSequence++, &task});
+    task.resumed.wait(lock, [&] { return task.running; });
+}
+
+// Hands the caller's slot to the best waiting task, or returns it to the free count. Needs the mutex held
+void Scheduler::releaseSlot() {
+    if (waiting.empty()) {
+        ++freeSlots;
+        return;
+    }
+    Task* next = waiting.top().task;
+    waiting.pop();
+    next->running = true;
+    next->resumed.notify_one();
+}
+
+void Scheduler::yield(Task& task) {
+    unique_lock<std::mutex> lock(mutex);
+    // Keep running unless someone at least as important is waiting
+    if (waiting.empty() || waiting.top().priority < task.priority) return;
+    task.running = false;
+    releaseSlot();
+    acquireSlot(task, lock);
+}
+
+future<ScriptResult> Scheduler::submit(const string& path, int priority, chrono::milliseconds timeout) {
+    return start(path, nullptr, priority, timeout);
+}
+
+future<ScriptResult> Scheduler::submit(shared_ptr<const Program> program, int priority, chrono::milliseconds timeout) {
+    return start("", move(program), priority, timeout);
+}
+
+future<ScriptResult> Scheduler::start(const string& path, shared_ptr<const Program> program, int priority,
+                                      chrono::milliseconds timeout) {
+    auto done = make_shared<promise<ScriptResult>>();
+    future<ScriptResult> result = done->get_future();
+
+    lock_guard<std::mutex> lock(mutex);
+    reapFinished();
+    // Reaping happens under the mutex, which is held until the new thread has been stored in `self`
+    auto self = threads.emplace(threads.end());
+    *self = thread([this, path, program, priority, timeout, done, self] {
+        Task task(*this, priority, timeout);
+        {
+            unique_lock<std::mutex> slotLock(mutex);
+            acquireSlot(task, slotLock);
+        }
+
+        ScriptResult scriptResult;
+        scriptResult.path = path;
+        StringSink output;
+        RunOptions options;
+        options.output = &output;
+        options.control = &task;
+
+        const auto start = chrono::steady_clock::now();
+        // The slot must be given back even when the script throws
+        try {
+            static_cast<RunResult&>(scriptResult) = program ? run(*program, {}, options) : executeFile(path, options);
+        } catch (const exception& e) {
+            cerr << "ERROR: " << (path.empty() ? "Script" : path) << ": " << e.what() << endl;
+            scriptResult.error = e.what();
+        }
+        const auto end = chrono::steady_clock::now();
+        scriptResult.output = move(output.text);
+        scriptResult.milliseconds = chrono::duration<double, milli>(end - start).count();
+
+        {
+            lock_guard<std::mutex> slotLock(mutex);
+            releaseSlot();
+            finished.push_back(self);
+        }
+        done->set_value(move(scriptResult));
+    });
+    return result;
+}
+}  // namespace executor
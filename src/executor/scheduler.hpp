@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/executor/executor.hpp"
+
+namespace executor {
+/**
+ * Runs many scripts over a fixed number of execution slots. Scripts give their slot up at loop back-edges every
+ * `quantum` iterations when another script is waiting, so a runaway loop can neither block the scheduler nor
+ * outlive its timeout. Waiting scripts are resumed highest priority first, then in the order they started waiting.
+ *
+ * Every submitted script has its own thread that sleeps while the script is suspended, since its interpreter state
+ * lives on that thread's stack; only `slots` of them run at any time. Threads of finished scripts are joined by
+ * the next submit.
+ */
+class Scheduler {
+   private:
+    class Task;
+
+    struct Waiting {
+        int priority;
+        unsigned long long sequence;
+        Task* task;
+        bool operator<(const Waiting& other) const {
+            if (priority != other.priority) return priority < other.priority;
+            return sequence > other.sequence;
+        }
+    };
+
+    std::mutex mutex;
+    std::priority_queue<Waiting> waiting;
+    unsigned long long nextSequence = 0;
+    size_t freeSlots;
+    long long quantum;
+    std::list<std::thread> threads;
+    std::vector<std::list<std::thread>::iterator> finished;  // Threads whose script is done, not yet joined
+
+    void acquireSlot(Task& task, std::unique_lock<std::mutex>& lock);
+    void releaseSlot();
+    void reapFinished();
+    void yield(Task& task);
+    std::future<ScriptResult> start(const std::string& path, std::shared_ptr<const Program> program, int priority,
+                                    std::chrono::milliseconds timeout);
+
+   public:
+    explicit Scheduler(size_t slots = 0, long long quantum = 10000);
+    ~Scheduler();  // Waits for every submitted script to finish
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    /**
+     * Queues a script. A zero timeout lets it run until it finishes; otherwise it is stopped at its first
+     * checkpoint once `timeout` has passed since submission, and its result has timedOut set.
+     */
+    std::future<ScriptResult> submit(const std::string& path, int priority = 0,
+                                     std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    // Same as above for an already compiled program
+    std::future<ScriptResult> submit(std::shared_ptr<const Program> program, int priority = 0,
+                                     std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+};
+}  // namespace executor
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include "src/concurrency/thread_pool.hpp"
+#include "src/interpreter/natives.hpp"
+
+using namespace std;
+
+namespace {
+// Arrays shorter than this are sorted on the calling thread
+const size_t parallelSortThreshold = 1 << 16;
+
+// The int elements of `values`, or a NativeError naming `function` if any element is an array
+vector<int> intsOf(const Array& values, const char* function) {
+    vector<int> ints;
+    ints.reserve(values.size());
+    for (const auto& value : values) {
+        const int* element = get_if<int>(&value.v);
+        if (!element) throw NativeError(string(function) + "() needs an array of ints");
+        ints.push_back(*element);
+    }
+    return ints;
+}
+
+/**
+ * Sorts contiguous runs on the shared pool, then merges neighbouring runs pairwise, doubling the run length each
+ * round until one run is left.
+ */
+void parallelSort(vector<int>& ints) {
+    ThreadPool& pool = ThreadPool::shared();
+    const size_t runs = max<size_t>(pool.size(), 1);
+    const size_t runLength = (ints.size() + runs - 1) / runs;
+    auto boundary = [&](size_t run) { return ints.begin() + min(run * runLength, ints.size()); };
+
+    pool.parallelFor(runs, [&](size_t run) { sort(boundary(run), boundary(run + 1)); });
+    for (size_t width = 1; width < runs; width *= 2) {
+        pool.parallelFor((runs + 2 * width - 1) / (2 * width), [&](size_t pair) {
+            const size_t first = pair * 2 * width;
+            inplace_merge(boundary(first), boundary(first + width), boundary(first + 2 * width));
+        });
+    }
+}
+
+int extreme(const Array& values, const char* function, bool wantMax) {
+    if (values.empty()) throw NativeError(string(function) + "() of an empty array");
+    int best = wantMax ? INT_MIN : INT_MAX;
+    for (const auto& value : values) {
+        const int* element = get_if<int>(&value.v);
+        if (!element) throw NativeError(string(function) + "() needs an array of ints");
+        best = wantMax ? max(best, *element) : min(best, *element);
+    }
+    return best;
+}
+}  // namespace
+
+/**
+ * The array builtins work on the caller's array in place: nothing is copied in or out, and sort() reorders the
+ * array it is given. Matrix builtins likewise read their operands where they live.
+ */
+void addBuiltins(NativeRegistry& registry) {
+    Native sortNative = natives::make([](Array& values) {
+        vector<int> ints = intsOf(values, "sort");
+        if (ints.size() >= parallelSortThreshold) {
+            parallelSort(ints);
+        } else {
+            sort(ints.begin(), ints.end());
+        }
+        for (size_t i = 0; i < ints.size(); i++) values[i] = ints[i];
+    });
+    sortNative.preservesElements = true;
+    registry.add("sort", move(sortNative));
+
+    registry.add("sum", natives::make([](const Array& values) {
+        long long total = 0;
+        for (const auto& value : values) {
+            const int* element = get_if<int>(&value.v);
+            if (!element) throw NativeError("sum() needs an array of ints");
+            total += *element;
+        }
+        return static_cast<int>(total);
+    }));
+    registry.add("min", natives::make([](const Array& values) { return extreme(values, "min", false); }));
+    registry.add("max", natives::make([](const Array& values) { return extreme(values, "max", true); }));
+
+    // Index of the first element equal to x, or -1
+    registry.add("find", natives::make([](const Array& values, int x) {
+        for (size_t i = 0; i < values.size(); i++) {
+            const int* element = get_if<int>(&values[i].v);
+            if (element && *element == x) return static_cast<int>(i);
+        }
+        return -1;
+    }));
+    registry.add("count", natives::make([](const Array& values, int x) {
+        int matches = 0;
+        for (const auto& value : values) {
+            const int* element = get_if<int>(&value.v);
+            if (element && *element == x) matches++;
+        }
+        return matches;
+    }));
+
+    // A rows x cols matrix of zeros
+    registry.add("matrix", natives::make([](int rows, int cols) {
+        if (rows < 0 || cols < 0) throw NativeError("matrix() dimensions must not be negative");
+        return Matrix(rows, cols);
+    }));
+    registry.add("rows", natives::make([](const Matrix& m) { return m.rows(); }));
+    registry.add("cols", natives::make([](const Matrix& m) { return m.cols(); }));
+    registry.add("transpose", natives::make([](const Matrix& m) { return matrix::transpose(m); }));
+    registry.add("matmul", natives::make([](const Matrix& a, const Matrix& b) {
+        if (a.cols() != b.rows()) {
+            throw NativeError("matmul() of " + to_string(a.rows()) + "x" + to_string(a.cols()) + " and " +
+                              to_string(b.rows()) + "x" + to_string(b.cols()) + " matrices");
+        }
+        return matrix::multiply(a, b);
+    }));
+}
@@ -0,0 +1,138 @@
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "src/interpreter/natives.hpp"
+#include "src/utility/mapped_file.hpp"
+
+using namespace std;
+
+namespace {
+// Input is handed back to the kernel in steps of this many bytes, so only the array being built stays resident
+const size_t releaseInterval = 1 << 24;
+
+// Ints are stored as 4 little-endian bytes whatever the host byte order
+int decodeInt(const char* bytes) {
+    const auto* b = reinterpret_cast<const unsigned char*>(bytes);
+    return static_cast<int>(uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24);
+}
+
+void encodeInt(int value, char* bytes) {
+    const uint32_t bits = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; i++) bytes[i] = static_cast<char>(bits >> (8 * i));
+}
+
+const char* trimFront(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+    return begin;
+}
+
+const char* trimBack(const char* begin, const char* end) {
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    return end;
+}
+
+Array loadInts(const string& path) {
+    utility::MappedFile file(path);
+    if (!file.isOpen()) throw NativeError("load_ints() cannot open '" + path + "'");
+    if (file.size() % 4 != 0) throw NativeError("load_ints() size of '" + path + "' is not a multiple of 4 bytes");
+    file.adviseSequential();
+
+    Array values;
+    values.reserve(file.size() / 4);
+    for (size_t offset = 0; offset < file.size(); offset += 4) {
+        if (offset % releaseInterval == 0) file.release(offset);
+        values.emplace_back(decodeInt(file.data() + offset));
+    }
+    return values;
+}
+
+/**
+ * Reads column `column` (counting from 0) of every non-blank line. A first line whose field is not an int is taken
+ * as a header and skipped; anywhere else it is an error, as is a line with too few columns.
+ */
+Array loadCsvInts(const string& path, int column) {
+    if (column < 0) throw NativeError("load_csv_ints() column must not be negative");
+    utility::MappedFile file(path);
+    if (!file.isOpen()) throw NativeError("load_csv_ints() cannot open '" + path + "'");
+    file.adviseSequential();
+
+    Array values;
+    const char* const start = file.data();
+    const char* const end = start + file.size();
+    size_t nextRelease = releaseInterval;
+    bool firstRow = true;
+    int lineNumber = 0;
+    for (const char* line = start; line < end;) {
+        const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+        const char* lineEnd = newline ? newline : end;
+        const char* next = newline ? newline + 1 : end;
+        lineNumber++;
+        if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+        if (trimFront(line, lineEnd) == lineEnd) {
+            line = next;
+            continue;
+        }
+
+        const char* field = line;
+        for (int skipped = 0; field && skipped < column; skipped++) {
+            field = static_cast<const char*>(memchr(field, ',', lineEnd - field));
+            if (field) field++;
+        }
+        if (!field) {
+            throw NativeError("load_csv_ints() line " + to_string(lineNumber) + " of '" + path + "' has no column " +
+                              to_string(column));
+        }
+        const char* fieldEnd = static_cast<const char*>(memchr(field, ',', lineEnd - field));
+        if (!fieldEnd) fieldEnd = lineEnd;
+        field = trimFront(field, fieldEnd);
+        fieldEnd = trimBack(field, fieldEnd);
+
+        int value = 0;
+        const auto parsed = from_chars(field, fieldEnd, value);
+        if (parsed.ec == errc() && parsed.ptr == fieldEnd && field < fieldEnd) {
+            values.emplace_back(value);
+        } else if (!firstRow) {
+            throw NativeError("load_csv_ints() line " + to_string(lineNumber) + " of '" + path + "' column " +
+                              to_string(column) + " is not an int");
+        }
+        firstRow = false;
+
+        line = next;
+        if (size_t(line - start) >= nextRelease) {
+            file.release(line - start);
+            nextRelease += releaseInterval;
+        }
+    }
+    return values;
+}
+
+int saveInts(const Array& values, const string& path) {
+    string bytes(values.size() * 4, '\0');
+    for (size_t i = 0; i < values.size(); i++) {
+        const int* element = get_if<int>(&values[i].v);
+        if (!element) throw NativeError("save_ints() needs an array of ints");
+        encodeInt(*element, &bytes[i * 4]);
+    }
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.write(bytes.data(), bytes.size()) || !file.flush()) {
+        throw NativeError("save_ints() cannot write '" + path + "'");
+    }
+    return static_cast<int>(values.size());
+}
+}  // namespace
+
+/**
+ * Loading data from files. Inputs are memory mapped and decoded front to back, handing pages already read back to
+ * the kernel, so a file much larger than memory costs little beyond the array it becomes.
+ */
+void addDataBuiltins(NativeRegistry& registry) {
+    // A raw file of little-endian 32-bit ints, as written by save_ints()
+    registry.add("load_ints", natives::make(loadInts));
+    registry.add("load_csv_ints", natives::make(loadCsvInts));
+    // Writes the array as load_ints() reads it and returns the number of ints written
+    registry.add("save_ints", natives::make(saveInts));
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <climits>
+#include <stdexcept>
+
+/**
+ * Thrown from a checkpoint to stop a script that ran past its deadline
+ */
+struct ScriptTimeout : std::runtime_error {
+    ScriptTimeout() : std::runtime_error("script timed out") {}
+};
+
+/**
+ * Preemption hook for long running scripts. The interpreter decrements `remaining` on every loop back-edge and
+ * calls checkpoint() when it runs out. A checkpoint refills `remaining` and may block to let other scripts run,
+ * or throw to stop this one.
+ */
+class ExecutionControl {
+   public:
+    long long remaining = LLONG_MAX;
+
+    virtual ~ExecutionControl() = default;
+    virtual void checkpoint() { remaining = LLONG_MAX; }
+};
@@ -1,12 +1,21 @@
 #include "src/interpreter/interpreter.hpp"
 
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <variant>
 
 using namespace std;
 
+namespace {
+// Both operands of an OPERATOR or CONDITIONAL were proven int-only
+bool bothInt(const Node& node) {
+    return node.children[0]->staticType == StaticType::INT && node.children[1]->staticType == StaticType::INT;
+}
+}  // namespace
+
 // Deconstructor
 Interpreter::~Interpreter() {
     // Clean up any remaining scopes
@@ -15,15 +24,50 @@ Interpreter::~Interpreter() {
     }
 }
 
-// Adds a new scope to the scope stack
-void Interpreter::pushScope() { currentScope = new Scope(currentScope); }
+/**
+ * Forgets all variables, functions, output redirection and execution control so the interpreter can run another
+ * program
+ */
+void Interpreter::reset() {
+    while (currentScope != &globalScope) {
+        popScope();
+    }
+    globalScope.clear();
+    // Spare entries were charged to this run's memory tracker, so the next run starts without them
+    globalScope.releaseSpareNodes();
+    for (auto& scope : scopePool) {
+        scope->releaseSpareNodes();
+    }
+    functionTable.clear();
+    printBuffer.flush();
+    printBuffer.setSink(OutputSink::standard());
+    output = &printBuffer;
+    defaultControl.remaining = LLONG_MAX;
+    control = &defaultControl;
+    profile = nullptr;
+    shadow = nullptr;
+    // Idle interpreters wait in the executor's pool, so they hand their cached blocks back instead of keeping them
+    arrayPool.releaseAll();
+}
 
-// Pop the current scope and its parent become the new current scope
+// Adds a new scope to the scope stack, reusing a pooled frame when one is free
+void Interpreter::pushScope() {
+    if (profile) profile->scopePushes++;
+    if (scopeDepth == scopePool.size()) {
+        scopePool.push_back(make_unique<Scope>());
+    }
+    Scope* scope = scopePool[scopeDepth++].get();
+    scope->setParent(currentScope);
+    currentScope = scope;
+}
+
+// Pop the current scope and its parent become the new current scope. The frame keeps its hash table for reuse
 void Interpreter::popScope() {
     if (currentScope != &globalScope) {
         Scope* parent = currentScope->getParent();
-        delete currentScope;
+        currentScope->clear();
         currentScope = parent;
+        --scopeDepth;
     }
 }
 
@@ -35,6 +79,7 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
     switch (node->type) {
         case NodeType::PROGRAM: {
             for (int i = 0; i < node->children.size(); i++) {
+                if (shadow) shadow->setLine(node->children[i]->token.lineNumber);
                 Value val = evaluate(node->children[i]);
                 if (node->children[i]->type == NodeType::RETURN) {
                     return val;
@@ -50,19 +95,60 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
             Value last = 0;
             
             
-            while (evaluate(conditional).asInt() == 1) {
+            while (evaluateInt(conditional) == 1) {
                 last = evaluate(block);
+                if (--control->remaining <= 0) control->checkpoint();
             }
             return last;
         }
 
+        case NodeType::FOR: {
+            // for name in range(start, end, step): the bounds are evaluated once, before the first iteration
+            const Value start = evaluate(node->children[0]);
+            const Value end = evaluate(node->children[1]);
+            const Value step = evaluate(node->children[2]);
+            if (!(start.isInt() && end.isInt() && step.isInt())) {
+                cerr << "ERROR: range() arguments must be integers at line " << node->token.lineNumber << endl;
+                return 0;
+            }
+            if (step.asInt() == 0) {
+                cerr << "ERROR: range() step must not be 0 at line " << node->token.lineNumber << endl;
+                return 0;
+            }
+
+            // The loop variable is declared once, even for an empty range, and its slot is overwritten each iteration
+            if (profile) profile->variableLookups++;
+            currentScope->update(node->value, start);
+            Value* slot = currentScope->find(node->value);
+
+            // The body's frame is pushed once and cleared between iterations rather than pushed and popped each time
+            const Node& body = *node->children[3];
+            const bool ownScope = body.needsScope;
+            if (ownScope) pushScope();
+            Value last = 0;
+            const long long stop = end.asInt();
+            const long long stride = step.asInt();
+            for (long long i = start.asInt(); stride > 0 ? i < stop : i > stop; i += stride) {
+                *slot = static_cast<int>(i);
+                for (const auto& child : body.children) {
+                    if (shadow) shadow->setLine(child->token.lineNumber);
+                    last = evaluate(child);
+                    if (child->type == NodeType::RETURN) break;
+                }
+                if (ownScope) currentScope->clear();
+                if (--control->remaining <= 0) control->checkpoint();
+            }
+            if (ownScope) popScope();
+            return last;
+        }
+
         case NodeType::FUNC_CALL: {
             return evaluateFunctionCall(node);
         }
 
         case NodeType::DEF: {
             string funcName = node->value;
-            functionTable[funcName] = unique_ptr<Node>(node->clone());
+            functionTable[funcName] = node.get();
             return 0;
         }
 
@@ -74,19 +160,22 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
         }
 
         case NodeType::BLOCK: {
-            pushScope();
+            // Blocks that never declare a variable run directly in the enclosing scope
+            const bool ownScope = node->needsScope;
+            if (ownScope) pushScope();
             Value result = 0;
 
             // Evaluate all statements in the block
             for (const auto& child : node->children) {
+                if (shadow) shadow->setLine(child->token.lineNumber);
                 result = evaluate(child);
                 if (child->type == NodeType::RETURN) {
-                    popScope();
+                    if (ownScope) popScope();
                     return result;
                 }
             }
 
-            popScope();
+            if (ownScope) popScope();
             return result;
         }
 
@@ -95,7 +184,7 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
                 cerr << "ERROR: Malformed IF node at line " << node->token.lineNumber << endl;
                 return 0;
             }
-            bool condition = evaluate(node->children[0]).asInt();
+            bool condition = evaluateInt(node->children[0]);
             if (condition == 1) {
                 evaluate(node->children[1]);
             }
@@ -103,6 +192,9 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
         }
 
         case NodeType::CONDITIONAL: {
+            if (bothInt(*node)) {
+                return compare(*node, evaluateInt(node->children[0]), evaluateInt(node->children[1]));
+            }
             const Value& left = evaluate(node->children[0]);
             const Value& right = evaluate(node->children[1]);
 
@@ -111,108 +203,78 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
                      << endl;
                 return 0;
             }
-
-            const int leftInt = left.asInt();
-            const int rightInt = right.asInt();
-
-            if (node->value == "==") {
-                return leftInt == rightInt;
-            }
-            if (node->value == "<") {
-                return leftInt < rightInt;
-            }
-            if (node->value == ">") {
-                return leftInt > rightInt;
-            }
-            return 0;
+            return compare(*node, left.asInt(), right.asInt());
         }
 
         case NodeType::NUMBER: {
-            try {
-                return stoi(node->value);
-            } catch (const std::invalid_argument&) {
-                cerr << "ERROR: Invalid number format '" << node->value << "' at line " << node->token.lineNumber
-                     << endl;
-                return 0;
-            } catch (const std::out_of_range&) {
-                cerr << "ERROR: Number out of range '" << node->value << "' at line " << node->token.lineNumber << endl;
-                return 0;
-            }
+            return node->number;
         }
 
+        case NodeType::STRING:
+            cerr << "ERROR: Strings can only be passed to natives at line " << node->token.lineNumber << endl;
+            return 0;
+
         case NodeType::ARRAY: {
+            if (node->constant) return Value(node->constant);
             const int size = node->children.size();
-            vector<Value> arr;
+            Array arr;
             arr.reserve(size);
             for (const auto& child : node->children) {
                 arr.push_back(evaluate(child));
             }
-            return Value(arr);
+            return Value(move(arr));
         }
 
         case NodeType::VARIABLE: {
-            auto varName = node->value;
-            auto var = this->currentScope->lookup(varName);
-            if (var.first) {
-                return var.second;
+            if (profile) profile->variableLookups++;
+            if (const Value* var = currentScope->find(node->value)) {
+                return *var;
             }
             cerr << "ERROR: Variable '" << node->value << "' not found at line " << node->token.lineNumber << endl;
             return 0;
         }
 
         case NodeType::OPERATOR: {
+            if (bothInt(*node)) {
+                return applyOperator(*node, evaluateInt(node->children[0]), evaluateInt(node->children[1]));
+            }
             const Value& leftValue = evaluate(node->children[0]);
             const Value& rightValue = evaluate(node->children[1]);
 
             if (!(leftValue.isInt() && rightValue.isInt())) {
+                if (leftValue.isMatrix() || rightValue.isMatrix()) return matrixOperator(*node, leftValue, rightValue);
                 cerr << "ERROR: Invalid Operation of Array '" << node->value << "' at line " << node->token.lineNumber
                      << endl;
                 return 0;
             }
-            int left = leftValue.asInt();
-            int right = rightValue.asInt();
-
-            if (node->value == "+") {
-                return left + right;
-            }
-            if (node->value == "-") {
-                return left - right;
-            }
-            if (node->value == "*") {
-                return left * right;
-            }
-            if (node->value == "/") {
-                if (right == 0) {
-                    cerr << "ERROR: Division by zero at line " << node->token.lineNumber << endl;
-                    return 0;
-                }
-                return left / right;
-            } else {
-                return 0;
-            }
+            return applyOperator(*node, leftValue.asInt(), rightValue.asInt());
         }
 
         case NodeType::PRINT: {
             const Value& eval = evaluate(node->children[0]);
             if (eval.isArray()) {
                 const auto& arr = eval.asArray();
-                cout << "[";
-                int lastIndex = arr.size() - 1;
-                for (int i = 0; i < arr.size(); i++) {
-                    cout << arr[i].asInt();
-                    if (!(i == lastIndex)) {
-                        cout << ",";
-                    }
+                output->write('[');
+                for (size_t i = 0; i < arr.size(); i++) {
+                    if (i > 0) output->write(',');
+                    output->writeInt(arr[i].asInt());
                 }
-                cout << "]" << endl;
+                output->write("]\n", 2);
                 return 0;
             }
-            string result = to_string(eval.asInt());
-            cout << result << endl;
+            if (eval.isMatrix()) {
+                printMatrix(eval.asMatrix());
+                return 0;
+            }
+            output->writeInt(eval.asInt());
+            output->write('\n');
             return 0;
         }
 
         case NodeType::ASSIGN: {
+            // The parser has already reported an assignment whose right side failed to parse
+            if (node->children.size() < 2) return 0;
+
             // First, determine if this is a regular variable assignment or array index assignment
             auto& target = node->children[0];
             const Value value = evaluate(node->children[1]);
@@ -220,16 +282,49 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
             if (target->type == NodeType::VARIABLE) {
                 // Regular variable assignment
                 string varName = target->value;
+                if (profile) profile->variableLookups++;
                 this->currentScope->update(varName, value);
                 return value;
             } else if (target->type == NodeType::INDEX) {
                 // Array index assignment
                 auto& baseNode = target->children[0];  // Should be a VARIABLE node
+                if (baseNode->type == NodeType::INDEX) {
+                    bool failed = false;
+                    if (int* cell = matrixCell(*target, failed)) {
+                        if (!value.isInt()) {
+                            cerr << "ERROR: Matrix elements must be integers at line " << node->token.lineNumber
+                                 << endl;
+                            return 0;
+                        }
+                        *cell = value.asInt();
+                        return value;
+                    }
+                    if (failed) return 0;
+                }
                 if (baseNode->type != NodeType::VARIABLE) {
                     cerr << "ERROR: Cannot assign to non-variable expression" << endl;
                     return 0;
                 }
 
+                if (profile) profile->variableLookups++;
+                // A proven array is updated in place instead of being copied out and written back
+                Value* base = baseNode->staticType == StaticType::ARRAY ? currentScope->find(baseNode->value) : nullptr;
+                if (base && base->isArray()) {
+                    Value indexValue = evaluate(target->children[1]);
+                    if (!indexValue.isInt()) {
+                        cerr << "ERROR: Array index must be an integer at line " << node->token.lineNumber << endl;
+                        return 0;
+                    }
+                    const int index = indexValue.asInt();
+                    Array& array = base->asArray();
+                    if (index < 0 || index >= array.size()) {
+                        cerr << "ERROR: Array index out of bounds at line " << node->token.lineNumber << endl;
+                        return 0;
+                    }
+                    array[index] = value;
+                    return value;
+                }
+
                 string arrayName = baseNode->value;
                 auto lookupResult = this->currentScope->lookup(arrayName);
 
@@ -268,9 +363,82 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
             }
         }
 
+        case NodeType::COMPOUND_ASSIGN: {
+            // Read-modify-write on the variable or element where it lives, without copying anything out
+            const Value operand = evaluate(node->children[1]);
+            const auto& target = node->children[0];
+            const auto& baseNode = target->type == NodeType::INDEX ? target->children[0] : target;
+            if (baseNode->type == NodeType::INDEX) {
+                bool failed = false;
+                if (int* cell = matrixCell(*target, failed)) {
+                    if (!operand.isInt()) {
+                        cerr << "ERROR: Matrix elements must be integers at line " << node->token.lineNumber << endl;
+                        return 0;
+                    }
+                    *cell = applyOperator(*node, *cell, operand.asInt());
+                    return *cell;
+                }
+                if (failed) return 0;
+            }
+            if (baseNode->type != NodeType::VARIABLE) {
+                cerr << "ERROR: Invalid assignment target at line " << node->token.lineNumber << endl;
+                return 0;
+            }
+            if (profile) profile->variableLookups++;
+            Value* slot = currentScope->find(baseNode->value);
+            if (!slot) {
+                cerr << "ERROR: Variable '" << baseNode->value << "' not found at line " << node->token.lineNumber
+                     << endl;
+                return 0;
+            }
+
+            if (target->type == NodeType::INDEX) {
+                if (!slot->isArray()) {
+                    cerr << "ERROR: '" << baseNode->value << "' is not an array at line " << node->token.lineNumber
+                         << endl;
+                    return 0;
+                }
+                Value indexValue = evaluate(target->children[1]);
+                if (!indexValue.isInt()) {
+                    cerr << "ERROR: Array index must be an integer at line " << node->token.lineNumber << endl;
+                    return 0;
+                }
+                const int index = indexValue.asInt();
+                Array& array = slot->asArray();
+                if (index < 0 || index >= array.size()) {
+                    cerr << "ERROR: Array index out of bounds at line " << node->token.lineNumber << endl;
+                    return 0;
+                }
+                slot = &array[index];
+            }
+
+            int* current = get_if<int>(&slot->v);
+            if (!current || !operand.isInt()) {
+                cerr << "ERROR: Invalid Operation of Array '" << node->token.value << "' at line "
+                     << node->token.lineNumber << endl;
+                return 0;
+            }
+            *current = applyOperator(*node, *current, operand.asInt());
+            return *current;
+        }
+
         case NodeType::INDEX: {
+            // Index a proven array where it lives rather than copying it
+            const auto& baseNode = node->children[0];
+            if (baseNode->type == NodeType::INDEX) {
+                bool failed = false;
+                if (const int* cell = matrixCell(*node, failed)) return *cell;
+                if (failed) return 0;
+            }
+            if (baseNode->type == NodeType::VARIABLE && baseNode->staticType == StaticType::ARRAY) {
+                if (profile) profile->variableLookups++;
+                if (const Value* base = currentScope->find(baseNode->value)) {
+                    return base->asArray()[evaluate(node->children[1]).asInt()];
+                }
+            }
             const auto& variable = evaluate(node->children[0]);  // Evaluates variable
             const auto& index = evaluate(node->children[1]);  // Evaluates index value
+            if (variable.isMatrix()) return matrixRow(*node, variable.asMatrix(), index);
             return variable.asArray()[index.asInt()];
         }
 
@@ -282,45 +450,165 @@ Value Interpreter::evaluate(const unique_ptr<Node>& node) {
     return 0;
 }
 
-Value Interpreter::evaluateFunctionCall(const unique_ptr<Node>& funcNode) {
-    auto functionInterpreter = std::make_unique<Interpreter>();
+/**
+ * Evaluates a node for its int value. Nodes that type inference proved int-only are computed without building a
+ * Value for them or their int-only operands; everything else goes through evaluate().
+ */
+int Interpreter::evaluateInt(const unique_ptr<Node>& node) {
+    if (node->staticType == StaticType::INT) {
+        switch (node->type) {
+            case NodeType::NUMBER:
+                return node->number;
+
+            case NodeType::VARIABLE:
+                if (profile) profile->variableLookups++;
+                if (const Value* var = currentScope->find(node->value)) {
+                    if (const int* value = get_if<int>(&var->v)) return *value;
+                }
+                break;
+
+            case NodeType::OPERATOR:
+                if (bothInt(*node)) {
+                    return applyOperator(*node, evaluateInt(node->children[0]), evaluateInt(node->children[1]));
+                }
+                break;
+
+            case NodeType::CONDITIONAL:
+                if (bothInt(*node)) {
+                    return compare(*node, evaluateInt(node->children[0]), evaluateInt(node->children[1]));
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    return evaluate(node).asInt();
+}
+
+int Interpreter::applyOperator(const Node& node, int left, int right) {
+    if (node.value == "+") {
+        return left + right;
+    }
+    if (node.value == "-") {
+        return left - right;
+    }
+    if (node.value == "*") {
+        return left * right;
+    }
+    if (node.value == "/") {
+        if (right == 0) {
+            cerr << "ERROR: Division by zero at line " << node.token.lineNumber << endl;
+            return 0;
+        }
+        return left / right;
+    }
+    return 0;
+}
 
+int Interpreter::compare(const Node& node, int left, int right) {
+    if (node.value == "==") {
+        return left == right;
+    }
+    if (node.value == "<") {
+        return left < right;
+    }
+    if (node.value == ">") {
+        return left > right;
+    }
+    return 0;
+}
+
+Value Interpreter::evaluateFunctionCall(const unique_ptr<Node>& funcNode) {
     // Check if function exists before accessing it
-    if (functionTable.find(funcNode->value) == functionTable.end()) {
+    auto function = functionTable.find(funcNode->value);
+    if (function == functionTable.end()) {
+        if (const Native* native = NativeRegistry::instance().find(funcNode->value)) {
+            return callNative(*native, *funcNode);
+        }
+        if (funcNode->value == "pmap" || funcNode->value == "preduce") {
+            return evaluateParallel(funcNode);
+        }
+        // Snapshot marker, only meaningful to executor::saveSnapshot
+        if (funcNode->value == "checkpoint" && funcNode->children.empty()) {
+            return 0;
+        }
         cerr << "ERROR: Function '" << funcNode->value << "' not defined at line " << funcNode->token.lineNumber
              << endl;
         return 0;
     }
-    auto functionDef = functionTable[funcNode->value]->clone();
-
-    // Get parameter names
-    vector<string> paramNames;
-    for (int i = 0; i < functionDef->children.size() - 1; i++) {
-        paramNames.push_back(functionDef->children[i]->value);
-    }
+    const Node* functionDef = function->second;
+    auto functionInterpreter = std::make_unique<Interpreter>();
+    functionInterpreter->output = output;
+    functionInterpreter->control = control;
+    functionInterpreter->profile = profile;
 
     // Evaluate arguments from the call
-    vector<int> argValues;
+    vector<Value> argValues;
     for (const auto& argNode : funcNode->children) {
-        argValues.push_back(this->evaluate(argNode).asInt());
+        argValues.push_back(this->evaluate(argNode));
     }
 
     // Check parameter count
-    if (argValues.size() != paramNames.size()) {
+    if (argValues.size() != functionDef->children.size() - 1) {
         cerr << "ERROR: Function '" << funcNode->value << "' called with wrong number of arguments at line "
              << funcNode->token.lineNumber << endl;
         return 0;
     }
 
-    // Bind arguments to parameters and add to function interpreters global scope
-    for (int i = 0; i < paramNames.size(); i++) {
-        functionInterpreter->globalScope.update(paramNames[i], argValues[i]);
+    if (!profile && !shadow) return functionInterpreter->invoke(*functionDef, argValues);
+    functionInterpreter->shadow = shadow;
+    if (shadow) shadow->push(functionDef, funcNode->value);
+    if (profile) profile->functionCalls++;
+    const auto start = chrono::steady_clock::now();
+    Value result = functionInterpreter->invoke(*functionDef, argValues);
+    if (shadow) shadow->pop();
+    if (profile && profile->trace) profile->trace->add(funcNode->value, "call", start, chrono::steady_clock::now());
+    return result;
+}
+
+/**
+ * Calls a C++ native straight from its FUNC_CALL node. Variables are passed as pointers to their storage, so arrays
+ * reach the native without being copied; other arguments are evaluated into temporaries.
+ */
+Value Interpreter::callNative(const Native& native, const Node& funcNode) {
+    if (funcNode.children.size() != native.arity) {
+        cerr << "ERROR: Function '" << funcNode.value << "' called with wrong number of arguments at line "
+             << funcNode.token.lineNumber << endl;
+        return 0;
     }
 
-    // Execute function body
-    if (functionDef->children.size() > paramNames.size()) {
-        return functionInterpreter->evaluate(functionDef->children.back());
+    Value temporaries[Native::maxArity];
+    Value* args[Native::maxArity];
+    for (size_t i = 0; i < native.arity; i++) {
+        const auto& argNode = funcNode.children[i];
+        args[i] = &temporaries[i];
+        if (argNode->type == NodeType::STRING) continue;  // Read from the node by natives taking a string
+        if (argNode->type == NodeType::VARIABLE) {
+            if (profile) profile->variableLookups++;
+            if (Value* variable = currentScope->find(argNode->value)) {
+                args[i] = variable;
+                continue;
+            }
+        }
+        temporaries[i] = evaluate(argNode);
+    }
+    return native.call(args, funcNode);
+}
+
+/**
+ * Binds arguments to the parameters of a DEF node in this interpreter's global scope and runs the body.
+ * Parameters are rebound on every call so one interpreter can be reused for many calls of the same function.
+ */
+Value Interpreter::invoke(const Node& functionDef, const vector<Value>& args) {
+    const size_t paramCount = functionDef.children.size() - 1;
+    for (size_t i = 0; i < paramCount; i++) {
+        globalScope.update(functionDef.children[i]->value, args[i]);
     }
 
+    // Execute function body
+    if (functionDef.children.size() > paramCount) {
+        return evaluate(functionDef.children.back());
+    }
     return 0;
-}
\ No newline at end of file
+}
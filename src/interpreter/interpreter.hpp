@@ -1,23 +1,63 @@
 #pragma once
 #include <unordered_map>
 
+#include "../output/output.hpp"
+#include "execution_control.hpp"
+#include "natives.hpp"
 #include "../parser/parser.hpp"
+#include "../profiling/profile.hpp"
+#include "../profiling/sampler.hpp"
 #include "../scope/scope.hpp"
 
 class Interpreter {
    public:
+    // Serves the arrays and scope tables of runs the executor activates it for. Declared first so it outlives them
+    ArrayPool arrayPool;
+
     Scope globalScope;
     Scope* currentScope;
 
-    std::unordered_map<std::string, std::unique_ptr<Node>> functionTable;
+    // Where PRINT writes. Function calls share their caller's buffer
+    OutputBuffer printBuffer;
+    OutputBuffer* output = &printBuffer;
+
+    // Back-edge budget. Without a host-provided control the budget never realistically runs out
+    ExecutionControl defaultControl;
+    ExecutionControl* control = &defaultControl;
+
+    // Counters for --stats, only touched when set. Function calls share their caller's profile
+    Profile* profile = nullptr;
+
+    // Script call stack for the sampling profiler, kept up to date only when set
+    ShadowStack* shadow = nullptr;
+
+    // DEF nodes are borrowed from the AST being evaluated, which must outlive the interpreter's use of them
+    std::unordered_map<std::string, const Node*> functionTable;
 
    private:
+    // Block scopes are pooled frames; scopePool[0 .. scopeDepth) are in use
+    std::vector<std::unique_ptr<Scope>> scopePool;
+    size_t scopeDepth = 0;
+
     void pushScope();
     void popScope();
 
    public:
     Interpreter() : currentScope(&globalScope) {};
     ~Interpreter();
+    void reset();
     Value evaluate(const std::unique_ptr<Node>& node);
+    int evaluateInt(const std::unique_ptr<Node>& node);
     Value evaluateFunctionCall(const std::unique_ptr<Node>& node);
+    Value invoke(const Node& functionDef, const std::vector<Value>& args);
+
+   private:
+    Value evaluateParallel(const std::unique_ptr<Node>& node);
+    Value callNative(const Native& native, const Node& funcNode);
+    int* matrixCell(const Node& indexNode, bool& failed);
+    Value matrixRow(const Node& indexNode, const Matrix& matrix, const Value& index);
+    Value matrixOperator(const Node& node, const Value& left, const Value& right);
+    void printMatrix(const Matrix& matrix);
+    int applyOperator(const Node& node, int left, int right);
+    int compare(const Node& node, int left, int right);
 };
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <string>
+
+#include "src/interpreter/interpreter.hpp"
+
+using namespace std;
+
+/**
+ * Resolves `m[i][j]` to the cell it names when `m` is a matrix variable, without copying the matrix or its row.
+ * Returns nullptr with `failed` clear when `indexNode` is not such an index, so the caller can handle it as an array,
+ * and nullptr with `failed` set after reporting a bad index.
+ */
+int* Interpreter::matrixCell(const Node& indexNode, bool& failed) {
+    const Node& rowNode = *indexNode.children[0];
+    const Node& baseNode = *rowNode.children[0];
+    if (baseNode.type != NodeType::VARIABLE) return nullptr;
+    if (profile) profile->variableLookups++;
+    Value* base = currentScope->find(baseNode.value);
+    if (!base || !base->isMatrix()) return nullptr;
+
+    const Value row = evaluate(rowNode.children[1]);
+    const Value col = evaluate(indexNode.children[1]);
+    // Evaluating the indexes cannot rebind variables, so `base` is still the matrix
+    Matrix& matrix = base->asMatrix();
+    if (!row.isInt() || !col.isInt() || !matrix.contains(row.asInt(), col.asInt())) {
+        cerr << "ERROR: Matrix index out of bounds at line " << indexNode.token.lineNumber << endl;
+        failed = true;
+        return nullptr;
+    }
+    return &matrix.at(row.asInt(), col.asInt());
+}
+
+// `m[i]` on its own is a copy of row i as an array
+Value Interpreter::matrixRow(const Node& indexNode, const Matrix& matrix, const Value& index) {
+    if (!index.isInt() || !matrix.contains(index.asInt(), 0)) {
+        cerr << "ERROR: Matrix index out of bounds at line " << indexNode.token.lineNumber << endl;
+        return 0;
+    }
+    const int* row = matrix.row(index.asInt());
+    Array values(row, row + matrix.cols());
+    return Value(move(values));
+}
+
+/**
+ * Element-wise arithmetic with at least one matrix operand. Two matrices must have the same shape; an int operand
+ * applies to every element.
+ */
+Value Interpreter::matrixOperator(const Node& node, const Value& left, const Value& right) {
+    const char op = node.value[0];
+    if (node.value.size() != 1 || string("+-*/").find(op) == string::npos) {
+        cerr << "ERROR: Invalid Operation of Matrix '" << node.value << "' at line " << node.token.lineNumber << endl;
+        return 0;
+    }
+    bool ok = false;
+    if (left.isMatrix() && right.isMatrix()) {
+        const Matrix& a = left.asMatrix();
+        const Matrix& b = right.asMatrix();
+        if (a.rows() != b.rows() || a.cols() != b.cols()) {
+            cerr << "ERROR: Matrix shapes " << a.rows() << "x" << a.cols() << " and " << b.rows() << "x" << b.cols()
+                 << " do not match for '" << node.value << "' at line " << node.token.lineNumber << endl;
+            return 0;
+        }
+        Matrix result(a.rows(), a.cols());
+        ok = matrix::elementwise(op, a.data(), b.data(), result.data(), result.size());
+        if (ok) return Value(move(result));
+    } else if (left.isMatrix() && right.isInt()) {
+        const Matrix& a = left.asMatrix();
+        Matrix result(a.rows(), a.cols());
+        ok = matrix::elementwise(op, a.data(), right.asInt(), result.data(), result.size());
+        if (ok) return Value(move(result));
+    } else if (left.isInt() && right.isMatrix()) {
+        const Matrix& b = right.asMatrix();
+        Matrix result(b.rows(), b.cols());
+        ok = matrix::elementwise(op, left.asInt(), b.data(), result.data(), result.size());
+        if (ok) return Value(move(result));
+    } else {
+        cerr << "ERROR: Invalid Operation of Array '" << node.value << "' at line " << node.token.lineNumber << endl;
+        return 0;
+    }
+    cerr << "ERROR: Division by zero at line " << node.token.lineNumber << endl;
+    return 0;
+}
+
+// One line per row, formatted like a printed array
+void Interpreter::printMatrix(const Matrix& matrix) {
+    for (int r = 0; r < matrix.rows(); r++) {
+        const int* row = matrix.row(r);
+        output->write('[');
+        for (int c = 0; c < matrix.cols(); c++) {
+            if (c > 0) output->write(',');
+            output->writeInt(row[c]);
+        }
+        output->write("]\n", 2);
+    }
+}
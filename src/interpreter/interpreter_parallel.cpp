@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <mutex>
+
+#include "src/concurrency/thread_pool.hpp"
+#include "src/interpreter/interpreter.hpp"
+
+using namespace std;
+
+namespace {
+// Arrays are only split once each chunk has at least this many elements
+const size_t minChunkSize = 1024;
+
+/**
+ * Returns the first node that stops a function body from running on a worker thread, or nullptr if it is safe.
+ * Function frames bind parameters in their own global scope and cannot see the caller's variables, so assignments
+ * can never reach an outer scope. That leaves output and calls or definitions whose bodies we cannot vouch for.
+ */
+const Node* findUnsafeNode(const Node& node) {
+    if (node.type == NodeType::PRINT || node.type == NodeType::FUNC_CALL || node.type == NodeType::DEF) {
+        return &node;
+    }
+    for (const auto& child : node.children) {
+        if (!child) continue;
+        if (const Node* unsafe = findUnsafeNode(*child)) return unsafe;
+    }
+    return nullptr;
+}
+
+/**
+ * Execution control of one chunk's frame. The caller's control is not thread-safe, so chunks count their own loop
+ * back-edges and take turns calling its checkpoint, which may stop the whole call with ScriptTimeout or wait while
+ * other scripts use the caller's slot.
+ */
+class ChunkControl : public ExecutionControl {
+   private:
+    ExecutionControl& caller;
+    mutex& turn;
+
+   public:
+    ChunkControl(ExecutionControl& caller, mutex& turn) : caller(caller), turn(turn) {
+        lock_guard<mutex> lock(turn);
+        remaining = caller.remaining;
+    }
+
+    void checkpoint() override {
+        lock_guard<mutex> lock(turn);
+        caller.checkpoint();
+        remaining = caller.remaining;
+    }
+};
+
+/**
+ * Runs every chunk on the shared pool under the caller's memory tracker. Chunks allocate from a pool of their own
+ * when the caller uses one, since the caller's pool may only be touched by its own thread. It is released when the
+ * chunk finishes, so idle workers hold no cached blocks. An
+ * exception thrown by a chunk (such as MemoryBudgetExceeded) is rethrown on the calling thread once all chunks have
+ * finished.
+ */
+void runChunks(size_t chunkCount, const function<void(size_t)>& runChunk) {
+    MemoryTracker* tracker = MemoryTracker::active();
+    const bool pooled = ArrayPool::active() != nullptr;
+    exception_ptr failure;
+    mutex failureMutex;
+
+    ThreadPool::shared().parallelFor(chunkCount, [&](size_t chunk) {
+        ArrayPool chunkPool;
+        MemoryTracker::Activation activation(tracker);
+        ArrayPool::Activation pooling(pooled ? &chunkPool : nullptr);
+        try {
+            runChunk(chunk);
+        } catch (...) {
+            lock_guard<mutex> lock(failureMutex);
+            if (!failure) failure = current_exception();
+        }
+    });
+
+    if (failure) rethrow_exception(failure);
+}
+}  // namespace
+
+/**
+ * Evaluates the pmap(f, arr) and preduce(f, arr, init) builtins. The array is split into chunks that run on the
+ * shared work-stealing pool, each chunk with its own call frame over the read-only function AST in functionTable.
+ * preduce folds every chunk separately and then folds the partial results onto init, so f must be associative.
+ */
+Value Interpreter::evaluateParallel(const unique_ptr<Node>& callNode) {
+    const string& name = callNode->value;
+    const bool isReduce = name == "preduce";
+    const size_t expectedArgs = isReduce ? 3 : 2;
+    const size_t expectedParams = isReduce ? 2 : 1;
+
+    if (callNode->children.size() != expectedArgs) {
+        cerr << "ERROR: '" << name << "' expects " << expectedArgs << " arguments at line "
+             << callNode->token.lineNumber << endl;
+        return 0;
+    }
+
+    const auto& funcArg = callNode->children[0];
+    if (funcArg->type != NodeType::VARIABLE || functionTable.find(funcArg->value) == functionTable.end()) {
+        cerr << "ERROR: First argument of '" << name << "' must be a defined function at line "
+             << callNode->token.lineNumber << endl;
+        return 0;
+    }
+
+    const Node& functionDef = *functionTable[funcArg->value];
+    if (functionDef.children.size() - 1 != expectedParams) {
+        cerr << "ERROR: Function '" << funcArg->value << "' must take " << expectedParams << " parameter(s) for '"
+             << name << "' at line " << callNode->token.lineNumber << endl;
+        return 0;
+    }
+
+    if (const Node* unsafe = findUnsafeNode(*functionDef.children.back())) {
+        cerr << "ERROR: Function '" << funcArg->value << "' cannot run in parallel, it uses '" << unsafe->token.value
+             << "' at line " << unsafe->token.lineNumber << endl;
+        return 0;
+    }
+
+    const Value arrayValue = evaluate(callNode->children[1]);
+    if (!arrayValue.isArray()) {
+        cerr << "ERROR: Second argument of '" << name << "' must be an array at line " << callNode->token.lineNumber
+             << endl;
+        return 0;
+    }
+    const Array& input = arrayValue.asArray();
+
+    const size_t chunkCount = max<size_t>(1, min(ThreadPool::shared().size() * 4, input.size() / minChunkSize));
+    const size_t chunkSize = (input.size() + chunkCount - 1) / chunkCount;
+
+    mutex controlTurn;
+    if (!isReduce) {
+        Array output(input.size());
+        runChunks(chunkCount, [&](size_t chunk) {
+            ChunkControl chunkControl(*control, controlTurn);
+            Interpreter frame;
+            frame.control = &chunkControl;
+            vector<Value> args(1);
+            const size_t end = min(input.size(), (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++) {
+                args[0] = input[i];
+                output[i] = frame.invoke(functionDef, args);
+            }
+        });
+        return Value(move(output));
+    }
+
+    Value result = evaluate(callNode->children[2]);
+    vector<Value> partials(chunkCount);
+    vector<char> hasPartial(chunkCount, 0);
+    runChunks(chunkCount, [&](size_t chunk) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = min(input.size(), begin + chunkSize);
+        if (begin >= end) return;
+
+        ChunkControl chunkControl(*control, controlTurn);
+        Interpreter frame;
+        frame.control = &chunkControl;
+        vector<Value> args(2);
+        Value acc = input[begin];
+        for (size_t i = begin + 1; i < end; i++) {
+            args[0] = acc;
+            args[1] = input[i];
+            acc = frame.invoke(functionDef, args);
+        }
+        partials[chunk] = acc;
+        hasPartial[chunk] = 1;
+    });
+
+    Interpreter frame;
+    frame.control = control;
+    vector<Value> args(2);
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        if (!hasPartial[chunk]) continue;
+        args[0] = result;
+        args[1] = partials[chunk];
+        result = frame.invoke(functionDef, args);
+    }
+    return result;
+}
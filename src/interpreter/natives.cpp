@@ -0,0 +1,11 @@
+#include "src/interpreter/natives.hpp"
+
+NativeRegistry& NativeRegistry::instance() {
+    static NativeRegistry registry = [] {
+        NativeRegistry builtins;
+        addBuiltins(builtins);
+        addDataBuiltins(builtins);
+        return builtins;
+    }();
+    return registry;
+}
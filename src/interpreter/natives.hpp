@@ -0,0 +1,180 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "src/parser/parser.hpp"
+#include "src/scope/value.hpp"
+
+/**
+ * A C++ function callable from scripts. Arguments arrive as pointers to the caller's storage: a variable is passed
+ * without copying, any other expression as a temporary.
+ */
+struct Native {
+    static const size_t maxArity = 8;
+
+    size_t arity = 0;
+    StaticType returns = StaticType::UNKNOWN;  // What type inference may assume about the result
+    bool mutatesArrays = false;                // Takes an Array&, so array variables passed in may change
+    bool preservesElements = false;            // Array& parameters are only reordered, never given new elements
+    std::function<Value(Value* const* args, const Node& call)> call;
+};
+
+/**
+ * Thrown by a native to report a script error. The script sees the call return 0
+ */
+struct NativeError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+namespace natives {
+// How a parameter of a native is filled from a script value and the argument node that produced it
+template <class T>
+struct Argument;
+
+template <>
+struct Argument<int> {
+    static constexpr const char* expected = "an int";
+    static bool accepts(const Value& value, const Node&) { return value.isInt(); }
+    static int get(Value& value, const Node&) { return std::get<int>(value.v); }
+};
+
+template <>
+struct Argument<const Array&> {
+    static constexpr const char* expected = "an array";
+    static bool accepts(const Value& value, const Node&) { return value.isArray(); }
+    static const Array& get(Value& value, const Node&) { return std::as_const(value).asArray(); }  // Never copies
+};
+
+template <>
+struct Argument<Array&> : Argument<const Array&> {
+    static Array& get(Value& value, const Node&) { return value.asArray(); }
+};
+
+template <>
+struct Argument<const Matrix&> {
+    static constexpr const char* expected = "a matrix";
+    static bool accepts(const Value& value, const Node&) { return value.isMatrix(); }
+    static const Matrix& get(Value& value, const Node&) { return value.asMatrix(); }
+};
+
+template <>
+struct Argument<const Value&> {
+    static constexpr const char* expected = "a value";
+    static bool accepts(const Value&, const Node&) { return true; }
+    static const Value& get(Value& value, const Node&) { return value; }
+};
+
+// Strings are not values: only a literal can be passed, and the native reads it from the argument node
+template <>
+struct Argument<const std::string&> {
+    static constexpr const char* expected = "a string";
+    static bool accepts(const Value&, const Node& arg) { return arg.type == NodeType::STRING; }
+    static const std::string& get(Value&, const Node& arg) { return arg.value; }
+};
+
+template <class R>
+constexpr StaticType resultType() {
+    if (std::is_same<R, int>::value || std::is_void<R>::value) return StaticType::INT;
+    if (std::is_same<R, Array>::value) return StaticType::ARRAY;
+    if (std::is_same<R, Matrix>::value) return StaticType::MATRIX;
+    return StaticType::UNKNOWN;
+}
+
+// Parameter and result types of a function pointer or lambda
+template <class F>
+struct Signature : Signature<decltype(&F::operator())> {};
+
+template <class R, class... A>
+struct Signature<R (*)(A...)> {
+    using Result = R;
+    using Arguments = std::tuple<A...>;
+};
+
+template <class C, class R, class... A>
+struct Signature<R (C::*)(A...) const> : Signature<R (*)(A...)> {};
+
+template <class C, class R, class... A>
+struct Signature<R (C::*)(A...)> : Signature<R (*)(A...)> {};
+
+template <class F, class R, class... A, size_t... I>
+Native bind(F fn, std::tuple<A...>*, std::index_sequence<I...>) {
+    static_assert(sizeof...(A) <= Native::maxArity, "natives take at most Native::maxArity arguments");
+
+    Native native;
+    native.arity = sizeof...(A);
+    native.returns = resultType<R>();
+    native.mutatesArrays = (std::is_same<A, Array&>::value || ...);
+    native.call = [fn](Value* const* args, const Node& call) -> Value {
+        // Every argument is checked before the function runs so it never sees a value of the wrong shape
+        const bool accepted[] = {Argument<A>::accepts(*args[I], *call.children[I])..., true};
+        const char* expected[] = {Argument<A>::expected..., ""};
+        for (size_t i = 0; i < sizeof...(A); i++) {
+            if (accepted[i]) continue;
+            std::cerr << "ERROR: Argument " << i + 1 << " of '" << call.value << "' must be " << expected[i]
+                      << " at line " << call.token.lineNumber << std::endl;
+            return 0;
+        }
+        try {
+            if constexpr (std::is_void<R>::value) {
+                fn(Argument<A>::get(*args[I], *call.children[I])...);
+                return 0;
+            } else {
+                return Value(fn(Argument<A>::get(*args[I], *call.children[I])...));
+            }
+        } catch (const NativeError& error) {
+            std::cerr << "ERROR: " << error.what() << " at line " << call.token.lineNumber << std::endl;
+            return 0;
+        }
+    };
+    return native;
+}
+
+// Wraps a function pointer or lambda as a Native
+template <class F>
+Native make(F fn) {
+    using Arguments = typename Signature<std::decay_t<F>>::Arguments;
+    return bind<F, typename Signature<std::decay_t<F>>::Result>(
+        fn, static_cast<Arguments*>(nullptr), std::make_index_sequence<std::tuple_size<Arguments>::value>());
+}
+}  // namespace natives
+
+/**
+ * Natives by name. Register them before compiling scripts that call them, since type inference relies on their
+ * result types, and before any script runs: lookups from running interpreters are not locked.
+ */
+class NativeRegistry {
+   private:
+    std::unordered_map<std::string, Native> functions;
+
+   public:
+    static NativeRegistry& instance();
+
+    void add(const std::string& name, Native native) { functions[name] = std::move(native); }
+    const Native* find(const std::string& name) const {
+        auto found = functions.find(name);
+        return found == functions.end() ? nullptr : &found->second;
+    }
+};
+
+// The array and matrix builtins every registry starts with
+void addBuiltins(NativeRegistry& registry);
+// load_ints(), load_csv_ints() and save_ints(), which every registry also starts with
+void addDataBuiltins(NativeRegistry& registry);
+
+/**
+ * Makes `fn` callable from scripts as `name`. Parameters may be int, const Array&, Array& (the caller's array,
+ * updated in place), const Matrix&, const Value& or const std::string& (a string literal); the result may be int,
+ * Array, Matrix, Value or void (which scripts see as 0). A native reports a script error by throwing NativeError.
+ * Script functions with the same name take precedence.
+ */
+template <class F>
+void registerNative(const std::string& name, F fn) {
+    NativeRegistry::instance().add(name, natives::make(fn));
+}
@@ -124,12 +124,29 @@ vector<Token> Lexer::tokenize_statement(const string& code) {
                 ++characterPosition;
                 break;
 
+            // Strings run to the closing quote on the same line and have no escapes
+            case '"': {
+                const size_t close = code.find_first_of("\"\n", characterPosition + 1);
+                if (close == string::npos || code[close] != '"') {
+                    cerr << "ERROR LEXING line " << lineNumber << " unterminated string\n";
+                    characterPosition = close == string::npos ? len : close;
+                    break;
+                }
+                tokens.push_back({TokenType::STRING, code.substr(characterPosition + 1, close - characterPosition - 1),
+                                  lineNumber});
+                characterPosition = close + 1;
+                break;
+            }
+
             // Tokenizes '/' or '//'
             case '/':
                 if (characterPosition + 1 < len && code[characterPosition + 1] == '/') {
                     while (characterPosition < len && code[characterPosition] != '\n') {
                         ++characterPosition;
                     }
+                } else if (characterPosition + 1 < len && code[characterPosition + 1] == '=') {
+                    tokens.push_back({TokenType::DIVIDE_ASSIGN, "/=", lineNumber});
+                    characterPosition += 2;
                 } else {
                     tokens.push_back({TokenType::DIVIDE, "/", lineNumber});
                     ++characterPosition;
@@ -149,20 +166,23 @@ vector<Token> Lexer::tokenize_statement(const string& code) {
                 }
                 break;
 
+            // Tokenizes '+', '-' and '*' or their compound assignments '+=', '-=' and '*='
             case '+':
-                tokens.push_back({TokenType::PLUS, "+", lineNumber});
-                ++characterPosition;
-                break;
-
             case '-':
-                tokens.push_back({TokenType::SUBTRACT, "-", lineNumber});
-                ++characterPosition;
-                break;
-
-            case '*':
-                tokens.push_back({TokenType::MULTIPLY, "*", lineNumber});
-                ++characterPosition;
+            case '*': {
+                const bool compound = characterPosition + 1 < len && code[characterPosition + 1] == '=';
+                TokenType type;
+                if (c == '+') {
+                    type = compound ? TokenType::PLUS_ASSIGN : TokenType::PLUS;
+                } else if (c == '-') {
+                    type = compound ? TokenType::SUBTRACT_ASSIGN : TokenType::SUBTRACT;
+                } else {
+                    type = compound ? TokenType::MULTIPLY_ASSIGN : TokenType::MULTIPLY;
+                }
+                tokens.push_back({type, compound ? string{c, '='} : string(1, c), lineNumber});
+                characterPosition += compound ? 2 : 1;
                 break;
+            }
 
             case '<':
                 tokens.push_back({TokenType::LESSTHAN, "<", lineNumber});
@@ -200,8 +220,9 @@ Token Lexer::tokenizeAlpha(const string& code) {
     string str;
     str.push_back(c);
 
-    // Look over the string of chars and push to the string
-    while (characterPosition + 1 < code.size() && isalpha(code[characterPosition + 1])) {
+    // Look over the string of chars and push to the string; names may contain underscores after the first letter
+    while (characterPosition + 1 < code.size() &&
+           (isalpha(code[characterPosition + 1]) || code[characterPosition + 1] == '_')) {
         c = code[++characterPosition];
         str.push_back(c);
     }
@@ -218,6 +239,10 @@ Token Lexer::tokenizeAlpha(const string& code) {
         token.type = TokenType::RETURN;
     } else if (str == "while") {
         token.type = TokenType::WHILE;
+    } else if (str == "for") {
+        token.type = TokenType::FOR;
+    } else if (str == "in") {
+        token.type = TokenType::IN;
     } else {
         token.type = TokenType::IDENTIFIER;
     }
@@ -21,9 +21,12 @@ enum class TokenType {
     IF,
     DEF,
     WHILE,
+    FOR,
+    IN,
     // USER DEFINED/LITERALS
     IDENTIFIER,
     NUMBER,
+    STRING,  // A double-quoted literal such as a file path, with the quotes stripped
     // OPERATORS
     RETURN,
     ASSIGN,
@@ -31,6 +34,10 @@ enum class TokenType {
     SUBTRACT,
     MULTIPLY,
     DIVIDE,
+    PLUS_ASSIGN,
+    SUBTRACT_ASSIGN,
+    MULTIPLY_ASSIGN,
+    DIVIDE_ASSIGN,
     EQUALS,
     LESSTHAN,
     GREATERTHAN,
@@ -40,7 +47,7 @@ enum class TokenType {
 struct Token {
     TokenType type;
     std::string value;
-    size_t lineNumber;
+    size_t lineNumber = 0;
 
     Token() {};
 
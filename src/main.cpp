@@ -1,20 +1,159 @@
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "src/codegen/cpp_emitter.hpp"
 #include "src/executor/executor.hpp"
+#include "src/optimizer/optimizer.hpp"
 #include "src/scope/value.hpp"
+#include "src/server/server.hpp"
+#include "src/utility/utility.hpp"
 
 using namespace std;
 
 int main(int argc, char* argv[]) {
+    // Switches that apply to every mode may appear anywhere on the command line
+    vector<string> args;
+    executor::CompileOptions compileOptions;
+    bool stats = false;
+    bool pooledArrays = true;
+    string tracePath;
+    string samplePath;
+    int sampleRate = 1000;
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--no-inline") {
+            compileOptions.inlineFunctions = false;
+        } else if (arg == "--no-pool") {
+            pooledArrays = false;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--sample-profile" && i + 1 < argc) {
+            samplePath = argv[++i];
+        } else if (arg == "--sample-rate" && i + 1 < argc) {
+            sampleRate = atoi(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+
     string filePath = "tests/test_arith.txt";
-    if (argc > 1) {
-        filePath = argv[1];
+    if (!args.empty()) {
+        filePath = args[0];
+    }
+
+    // main --serve /path/to.sock
+    if (filePath == "--serve") {
+        if (args.size() < 2) {
+            cerr << "Usage: main --serve <socket path>" << endl;
+            return 1;
+        }
+        return server::serve(args[1]);
+    }
+
+    // main --client /path/to.sock <script | -> [name=value ...]
+    if (filePath == "--client") {
+        if (args.size() < 3) {
+            cerr << "Usage: main --client <socket path> <script | -> [name=value ...]" << endl;
+            return 1;
+        }
+        return server::request(args[1], args[2], vector<string>(args.begin() + 3, args.end()));
+    }
+
+    // main --snapshot <snapshot file> <script>: run up to checkpoint() and save the state
+    // main --restore <snapshot file> <script>: run the rest of the script from a saved state
+    if (filePath == "--snapshot" || filePath == "--restore") {
+        if (args.size() < 3) {
+            cerr << "Usage: main " << filePath << " <snapshot file> <script>" << endl;
+            return 1;
+        }
+        auto program = executor::compile(utility::readFile(args[2]), compileOptions);
+        if (filePath == "--snapshot") {
+            return executor::saveSnapshot(*program, args[1]) ? 0 : 1;
+        }
+        Value restored = executor::runFromSnapshot(*program, args[1]).value;
+        cout << "Script returned " << (restored.isInt() ? restored.asInt() : 0);
+        return restored.isInt() ? restored.asInt() : 0;
+    }
+
+    // main --emit-cpp <script>: print the script translated to standalone C++
+    if (filePath == "--emit-cpp") {
+        if (args.size() < 2) {
+            cerr << "Usage: main --emit-cpp <script>" << endl;
+            return 1;
+        }
+        auto program = executor::compile(utility::readFile(args[1]), compileOptions);
+        return codegen::emitCpp(*program->ast, cout) ? 0 : 1;
     }
 
-    Value response = executor::executeFile(filePath);
+    // main --types <script>: show what type inference proved about the script
+    if (filePath == "--types") {
+        if (args.size() < 2) {
+            cerr << "Usage: main --types <script>" << endl;
+            return 1;
+        }
+        auto program = executor::compile(utility::readFile(args[1]), compileOptions);
+        auto report = optimizer::inferTypes(*program->ast);
+        cout << "Inferred types:\n";
+        for (const auto& fact : report.facts) cout << "  " << fact << "\n";
+        if (!report.failures.empty()) {
+            cout << "Could not infer:\n";
+            for (const auto& failure : report.failures) cout << "  " << failure << "\n";
+        }
+        return 0;
+    }
+
+    // main --inlining <script>: show which calls the inliner would replace, and which functions it skips
+    if (filePath == "--inlining") {
+        if (args.size() < 2) {
+            cerr << "Usage: main --inlining <script>" << endl;
+            return 1;
+        }
+        executor::CompileOptions plain;
+        plain.inlineFunctions = false;
+        auto program = executor::compile(utility::readFile(args[1]), plain);
+        cout << "Inlining:\n";
+        for (const auto& line : optimizer::inlineFunctions(*program->ast)) cout << "  " << line << "\n";
+        return 0;
+    }
+
+    // main [--stats] [--trace out.json] <script>: report where the run spent its time, optionally as a Chrome trace
+    Profile profile;
+    Trace trace;
+    executor::RunOptions options;
+    options.compileOptions = compileOptions;
+    options.pooledArrays = pooledArrays;
+    if (stats || !tracePath.empty()) options.profile = &profile;
+    if (!tracePath.empty()) profile.trace = &trace;
+
+    // main --sample-profile out.folded [--sample-rate hz] <script>: sample the script call stack on a CPU timer
+    Sampler sampler(filePath, sampleRate);
+    if (!samplePath.empty() && sampler.start()) options.shadow = &sampler.stack();
+
+    Value response = executor::executeFile(filePath, options).value;
+    sampler.stop();
+    if (options.shadow && !sampler.writeFolded(samplePath)) {
+        cerr << "ERROR: Could not write samples to " << samplePath << endl;
+    }
+    if (sampler.droppedCount() > 0) {
+        cerr << "WARNING: Sample buffer filled up, " << sampler.droppedCount() << " samples were dropped" << endl;
+    }
     if(response.isArray()){
        cout << "Script returned array of size " << response.asArray().size();
+    } else if (response.isMatrix()) {
+        cout << "Script returned " << response.asMatrix().rows() << "x" << response.asMatrix().cols() << " matrix";
+    } else {
+        cout << "Script returned " << response.asInt();
+    }
+    if (stats) {
+        cout << endl;
+        profile.print(cerr);
+    }
+    if (!tracePath.empty() && !trace.write(tracePath)) {
+        cerr << "ERROR: Could not write trace to " << tracePath << endl;
     }
-    cout << "Script returned " << response.asInt();
-    return response.asInt();
-}
\ No newline at end of file
+    return response.isInt() ? response.asInt() : 0;
+}
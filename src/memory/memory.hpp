@@ -0,0 +1,225 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/**
+ * Thrown when an allocation would take a script past its memory budget
+ */
+struct MemoryBudgetExceeded : std::bad_alloc {
+    const char* what() const noexcept override { return "script memory budget exceeded"; }
+};
+
+/**
+ * Counts the bytes held by one script run. Trackers are activated per thread, and every Array buffer, Scope
+ * table and AST node allocated while one is active is charged to it. Accounting is best effort: memory freed
+ * under a different tracker than the one it was charged to never drives the count below zero.
+ */
+class MemoryTracker {
+   private:
+    std::atomic<size_t> live{0};
+    std::atomic<size_t> peak{0};
+    std::atomic<size_t> allocations{0};
+    size_t budget;
+
+   public:
+    explicit MemoryTracker(size_t budget = 0) : budget(budget) {}
+
+    size_t liveBytes() const { return live.load(std::memory_order_relaxed); }
+    size_t peakBytes() const { return peak.load(std::memory_order_relaxed); }
+    size_t allocationCount() const { return allocations.load(std::memory_order_relaxed); }
+
+    void charge(size_t bytes) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (budget != 0 && now > budget) {
+            live.fetch_sub(bytes, std::memory_order_relaxed);
+            throw MemoryBudgetExceeded();
+        }
+        size_t highest = peak.load(std::memory_order_relaxed);
+        while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {
+        }
+    }
+
+    void release(size_t bytes) {
+        size_t current = live.load(std::memory_order_relaxed);
+        while (!live.compare_exchange_weak(current, current > bytes ? current - bytes : 0, std::memory_order_relaxed)) {
+        }
+    }
+
+    static MemoryTracker*& active() {
+        static thread_local MemoryTracker* tracker = nullptr;
+        return tracker;
+    }
+
+    // Makes a tracker active on this thread until the activation goes out of scope
+    class Activation {
+       private:
+        MemoryTracker* previous;
+
+       public:
+        explicit Activation(MemoryTracker* tracker) : previous(active()) { active() = tracker; }
+        ~Activation() { active() = previous; }
+        Activation(const Activation&) = delete;
+        Activation& operator=(const Activation&) = delete;
+    };
+};
+
+/**
+ * Free lists of small blocks by size class, so the Array buffers and Scope tables a loop frees are handed straight
+ * back to it instead of going through malloc. Pools are activated per thread like MemoryTracker and are only used
+ * by the thread they are active on, so they need no locking.
+ *
+ * Every small request is rounded up to its size class whether or not a pool is active, which makes blocks of one
+ * class interchangeable: a block may be freed into any pool, or with no pool active, however it was allocated.
+ * Blocks in use belong to nobody, so values may outlive the pool that served them. A pool keeps a bounded number of
+ * free blocks per class and releases them all when it is destroyed.
+ */
+class ArrayPool {
+   public:
+    static const size_t classCount = 32;
+    static const size_t largestBlock = 8192;  // Larger requests always go to operator new
+
+    // Classes step by 16 bytes up to 128, then by quarters of a power of two: 160, 192, 224, 256, 320, ... 8192
+    static size_t classOf(size_t bytes) {
+        if (bytes <= 128) return bytes == 0 ? 0 : (bytes - 1) / 16;
+        size_t power = 7;
+        while ((size_t(2) << power) < bytes) power++;
+        return 8 + (power - 7) * 4 + (bytes - 1 - (size_t(1) << power)) / (size_t(1) << (power - 2));
+    }
+
+    static size_t classSize(size_t sizeClass) {
+        if (sizeClass < 8) return (sizeClass + 1) * 16;
+        const size_t power = 7 + (sizeClass - 8) / 4;
+        return (size_t(1) << power) + ((sizeClass - 8) % 4 + 1) * (size_t(1) << (power - 2));
+    }
+
+   private:
+    static const size_t cachedBytesPerClass = 256 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    FreeBlock* freeLists[classCount] = {};
+    size_t cachedBlocks[classCount] = {};
+    size_t hitCount = 0;
+    size_t missCount = 0;
+
+   public:
+    ArrayPool() = default;
+    ~ArrayPool() { releaseAll(); }
+    ArrayPool(const ArrayPool&) = delete;
+    ArrayPool& operator=(const ArrayPool&) = delete;
+
+    // Allocations served from a free list and allocations that had to go to operator new
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+
+    // Bytes held in free lists, waiting to be reused
+    size_t cachedBytes() const {
+        size_t bytes = 0;
+        for (size_t sizeClass = 0; sizeClass < classCount; sizeClass++) {
+            bytes += cachedBlocks[sizeClass] * classSize(sizeClass);
+        }
+        return bytes;
+    }
+
+    void* take(size_t sizeClass) {
+        if (FreeBlock* block = freeLists[sizeClass]) {
+            freeLists[sizeClass] = block->next;
+            cachedBlocks[sizeClass]--;
+            hitCount++;
+            return block;
+        }
+        missCount++;
+        return ::operator new(classSize(sizeClass));
+    }
+
+    void give(void* p, size_t sizeClass) {
+        if (cachedBlocks[sizeClass] * classSize(sizeClass) >= cachedBytesPerClass) {
+            ::operator delete(p);
+            return;
+        }
+        freeLists[sizeClass] = new (p) FreeBlock{freeLists[sizeClass]};
+        cachedBlocks[sizeClass]++;
+    }
+
+    // Frees every cached block
+    void releaseAll() {
+        for (size_t sizeClass = 0; sizeClass < classCount; sizeClass++) {
+            while (FreeBlock* block = freeLists[sizeClass]) {
+                freeLists[sizeClass] = block->next;
+                ::operator delete(block);
+            }
+            cachedBlocks[sizeClass] = 0;
+        }
+    }
+
+    static void* allocate(size_t bytes) {
+        if (bytes > largestBlock) return ::operator new(bytes);
+        const size_t sizeClass = classOf(bytes);
+        if (ArrayPool* pool = active()) return pool->take(sizeClass);
+        return ::operator new(classSize(sizeClass));
+    }
+
+    static void deallocate(void* p, size_t bytes) {
+        if (bytes > largestBlock) {
+            ::operator delete(p);
+        } else if (ArrayPool* pool = active()) {
+            pool->give(p, classOf(bytes));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    static ArrayPool*& active() {
+        static thread_local ArrayPool* pool = nullptr;
+        return pool;
+    }
+
+    // Makes a pool active on this thread until the activation goes out of scope. A null pool means plain operator new
+    class Activation {
+       private:
+        ArrayPool* previous;
+
+       public:
+        explicit Activation(ArrayPool* pool) : previous(active()) { active() = pool; }
+        ~Activation() { active() = previous; }
+        Activation(const Activation&) = delete;
+        Activation& operator=(const Activation&) = delete;
+    };
+};
+
+/**
+ * Allocator that charges the active MemoryTracker and draws from the active ArrayPool, used for Arrays and Scope
+ * tables
+ */
+template <class T>
+struct TrackingAllocator {
+    using value_type = T;
+
+    TrackingAllocator() = default;
+    template <class U>
+    TrackingAllocator(const TrackingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if (n > size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+        if (MemoryTracker* tracker = MemoryTracker::active()) tracker->charge(n * sizeof(T));
+        return static_cast<T*>(ArrayPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (MemoryTracker* tracker = MemoryTracker::active()) tracker->release(n * sizeof(T));
+        ArrayPool::deallocate(p, n * sizeof(T));
+    }
+
+    template <class U>
+    bool operator==(const TrackingAllocator<U>&) const {
+        return true;
+    }
+    template <class U>
+    bool operator!=(const TrackingAllocator<U>&) const {
+        return false;
+    }
+};
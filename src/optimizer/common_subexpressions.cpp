@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/interpreter/natives.hpp"
+#include "src/optimizer/optimizer.hpp"
+
+using namespace std;
+
+namespace optimizer {
+namespace {
+using Names = unordered_set<string>;
+
+// Smallest expression worth a temporary
+const int minimumOperations = 2;
+
+/**
+ * Appends the canonical text of a pure expression to `key` and the variables it reads to `inputs`. Returns false
+ * for anything that is not built from numbers, variables, operators, comparisons and indexing.
+ */
+bool describe(const Node& node, string& key, Names& inputs) {
+    switch (node.type) {
+        case NodeType::NUMBER:
+            key += to_string(node.number);
+            return true;
+
+        case NodeType::VARIABLE:
+            key += "'" + node.value + "'";
+            inputs.insert(node.value);
+            return true;
+
+        case NodeType::OPERATOR:
+        case NodeType::CONDITIONAL:
+        case NodeType::INDEX:
+            if (node.children.size() != 2) return false;
+            key += node.type == NodeType::INDEX ? "[" : "(" + node.value;
+            for (const auto& child : node.children) {
+                key += " ";
+                if (!child || !describe(*child, key, inputs)) return false;
+            }
+            key += ")";
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// Calls that may change variables of the caller: natives that update an array in place, and checkpoint(), which
+// snapshots them
+bool changesCallerState(const Node& node) {
+    if (node.type == NodeType::FUNC_CALL) {
+        if (node.value == "checkpoint") return true;
+        const Native* native = NativeRegistry::instance().find(node.value);
+        if (native && native->mutatesArrays) return true;
+    }
+    for (const auto& child : node.children) {
+        if (child && changesCallerState(*child)) return true;
+    }
+    return false;
+}
+
+// Operators, comparisons and indexing in an expression
+int operations(const Node& node) {
+    int count = node.type == NodeType::OPERATOR || node.type == NodeType::CONDITIONAL || node.type == NodeType::INDEX;
+    for (const auto& child : node.children) {
+        if (child) count += operations(*child);
+    }
+    return count;
+}
+
+void collectNodes(const Node& node, unordered_set<const Node*>& nodes) {
+    nodes.insert(&node);
+    for (const auto& child : node.children) {
+        if (child) collectNodes(*child, nodes);
+    }
+}
+
+// A pure expression seen earlier in the current block whose inputs have not been assigned since
+struct Available {
+    unique_ptr<Node>* slot;  // The first occurrence, which the temporary replaces once there is a second
+    size_t statement;        // Index of the statement the first occurrence is evaluated by
+    const Node* anchor;      // That statement, or the temporary the first occurrence was moved into
+    Names inputs;
+    string temporary;
+};
+
+struct Block {
+    unordered_map<string, Available> available;
+    vector<vector<unique_ptr<Node>>> temporaries;  // Assignments to run before each statement, in order
+};
+
+class Eliminator {
+   private:
+    int nextTemporary = 0;
+
+    Node* newTemporary(Available& first, Block& block) {
+        Node& expression = **first.slot;
+        const Token token = expression.token;
+        first.temporary = "$cse" + to_string(nextTemporary++);
+
+        auto assign = make_unique<Node>(NodeType::ASSIGN, token, "=");
+        assign->addChild(make_unique<Node>(NodeType::VARIABLE, token, first.temporary));
+        assign->addChild(move(*first.slot));
+        *first.slot = make_unique<Node>(NodeType::VARIABLE, token, first.temporary);
+        Node* created = assign.get();
+
+        // Occurrences inside the moved expression are now evaluated by the new assignment, so any temporary they
+        // get later must be assigned before it
+        unordered_set<const Node*> moved;
+        collectNodes(*created->children[1], moved);
+        for (auto& entry : block.available) {
+            Available& other = entry.second;
+            if (other.temporary.empty() && moved.count(other.slot->get())) other.anchor = created;
+        }
+
+        auto& before = block.temporaries[first.statement];
+        auto position = find_if(before.begin(), before.end(), [&](const unique_ptr<Node>& t) {
+            return t.get() == first.anchor;
+        });
+        before.insert(position, move(assign));
+        return created;
+    }
+
+    /**
+     * Visits an expression in evaluation order. The largest pure subexpression seen before is replaced by a read
+     * of its temporary; one seen for the first time is remembered, along with its own subexpressions.
+     */
+    void visit(unique_ptr<Node>& slot, size_t statement, const Node& anchor, Block& block, bool rowOfIndex = false) {
+        if (!slot) return;
+        Node& node = *slot;
+        const bool compound =
+            node.type == NodeType::OPERATOR || node.type == NodeType::CONDITIONAL || node.type == NodeType::INDEX;
+
+        string key;
+        Names inputs;
+        // m[i] in m[i][j] stays put, since reading a matrix cell directly does not copy the row
+        if (compound && !rowOfIndex && describe(node, key, inputs)) {
+            auto found = block.available.find(key);
+            // Assigning a temporary costs about as much as a single operation saves, so those are recomputed
+            if (found != block.available.end() && operations(node) >= minimumOperations) {
+                Available& first = found->second;
+                if (first.temporary.empty()) newTemporary(first, block);
+                slot = make_unique<Node>(NodeType::VARIABLE, node.token, first.temporary);
+                return;
+            }
+            block.available.emplace(key, Available{&slot, statement, &anchor, move(inputs), ""});
+        }
+        for (size_t i = 0; i < node.children.size(); i++) {
+            visit(node.children[i], statement, anchor, block, node.type == NodeType::INDEX && i == 0);
+        }
+    }
+
+    void invalidate(const Names& assigned, Block& block) {
+        for (auto entry = block.available.begin(); entry != block.available.end();) {
+            const Names& inputs = entry->second.inputs;
+            const bool stale = any_of(inputs.begin(), inputs.end(), [&](const string& name) {
+                return assigned.count(name) != 0;
+            });
+            entry = stale ? block.available.erase(entry) : next(entry);
+        }
+    }
+
+   public:
+    /**
+     * Treats each list of statements as a basic block. Expressions are reused across the statements of one list,
+     * never from inside a nested block, and an IF, loop or assignment forgets every expression reading a variable
+     * it may assign. Loop conditions run again after the body, so they are left to loop-invariant code motion.
+     * Temporaries of a block with a scope of its own would be declared afresh every time it runs, which costs more
+     * than they save, so `reuse` is false for those and only their nested blocks are rewritten.
+     */
+    void eliminateIn(vector<unique_ptr<Node>>& statements, bool reuse) {
+        Block block;
+        block.temporaries.resize(statements.size());
+        for (size_t i = 0; i < statements.size(); i++) {
+            if (!statements[i]) continue;
+            Node& statement = *statements[i];
+
+            if (!reuse || changesCallerState(statement)) {
+                block.available.clear();
+            } else {
+                switch (statement.type) {
+                    case NodeType::ASSIGN:
+                    case NodeType::COMPOUND_ASSIGN:
+                        if (statement.children.size() >= 2) visit(statement.children[1], i, statement, block);
+                        break;
+
+                    case NodeType::PRINT:
+                    case NodeType::RETURN:
+                    case NodeType::IF:
+                        if (!statement.children.empty()) visit(statement.children[0], i, statement, block);
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+
+            switch (statement.type) {
+                case NodeType::IF:
+                case NodeType::WHILE:
+                case NodeType::FOR:
+                case NodeType::DEF:
+                    if (!statement.children.empty() && statement.children.back()) {
+                        Node& body = *statement.children.back();
+                        eliminateIn(body.children, !body.needsScope);
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            Names assigned;
+            collectAssigned(statement, assigned);
+            invalidate(assigned, block);
+            if (statement.type == NodeType::RETURN) break;
+        }
+
+        vector<unique_ptr<Node>> rewritten;
+        for (size_t i = 0; i < statements.size(); i++) {
+            for (auto& temporary : block.temporaries[i]) rewritten.push_back(move(temporary));
+            rewritten.push_back(move(statements[i]));
+        }
+        statements = move(rewritten);
+    }
+};
+}  // namespace
+
+/**
+ * Common subexpression elimination. A pure expression evaluated again in the same block, with none of its
+ * variables assigned in between, is computed once into a `$cse` temporary before the statement that first needs
+ * it. As with loop-invariant code motion, an expression that fails then reports its error once.
+ */
+void eliminateCommonSubexpressions(Node& program) { Eliminator().eliminateIn(program.children, true); }
+}  // namespace optimizer
@@ -0,0 +1,42 @@
+#include <memory>
+
+#include "src/optimizer/optimizer.hpp"
+
+using namespace std;
+
+namespace optimizer {
+namespace {
+/**
+ * Builds the value of an ARRAY literal whose elements are all NUMBER literals or such arrays themselves, leaving
+ * `constant` unset on any other array. Nested constants stay shared inside the outer array, so writing one row of
+ * a table copies that row and the outer array only.
+ */
+void share(Node& node) {
+    for (auto& child : node.children) {
+        if (child) share(*child);
+    }
+    if (node.type != NodeType::ARRAY) return;
+
+    Array elements;
+    elements.reserve(node.children.size());
+    for (const auto& child : node.children) {
+        if (!child) return;
+        if (child->type == NodeType::NUMBER) {
+            elements.emplace_back(child->number);
+        } else if (child->constant) {
+            elements.emplace_back(child->constant);
+        } else {
+            return;
+        }
+    }
+    node.constant = make_shared<const Array>(move(elements));
+}
+}  // namespace
+
+/**
+ * Evaluating an array literal allocates and fills a fresh array every time, which dominates loops and functions
+ * that look values up in a fixed table. Literals of constants are built here once instead; the interpreter hands
+ * out the shared array and Value::asArray copies it the first time anything writes to it.
+ */
+void shareConstantArrays(Node& program) { share(program); }
+}  // namespace optimizer
@@ -0,0 +1,239 @@
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/optimizer/optimizer.hpp"
+
+using namespace std;
+
+namespace optimizer {
+namespace {
+// Largest function body, in AST nodes, that is copied into its callers
+const size_t maxInlineNodes = 40;
+
+size_t countNodes(const Node& node) {
+    size_t count = 1;
+    for (const auto& child : node.children) {
+        if (child) count += countNodes(*child);
+    }
+    return count;
+}
+
+bool containsCall(const Node& node) {
+    if (node.type == NodeType::FUNC_CALL) return true;
+    for (const auto& child : node.children) {
+        if (child && containsCall(*child)) return true;
+    }
+    return false;
+}
+
+void countDefinitions(const Node& node, unordered_map<string, int>& definitions) {
+    if (node.type == NodeType::DEF) definitions[node.value]++;
+    for (const auto& child : node.children) {
+        if (child) countDefinitions(*child, definitions);
+    }
+}
+
+// Every variable `expression` reads must already be bound, since a function frame sees nothing else
+bool readsOnly(const Node& expression, const unordered_set<string>& bound, string& missing) {
+    if (expression.type == NodeType::VARIABLE && !bound.count(expression.value)) {
+        missing = expression.value;
+        return false;
+    }
+    for (const auto& child : expression.children) {
+        if (child && !readsOnly(*child, bound, missing)) return false;
+    }
+    return true;
+}
+
+/**
+ * Returns why a function cannot be inlined, or an empty string if it can. Inlinable bodies are straight-line:
+ * assignments to plain variables followed by a single return, calling nothing and reading only their parameters
+ * and earlier locals.
+ */
+string rejectReason(const Node& def) {
+    const Node* body = def.children.empty() ? nullptr : def.children.back().get();
+    if (!body || body->type != NodeType::BLOCK || body->children.empty()) return "it has no body";
+
+    const size_t size = countNodes(*body);
+    if (size > maxInlineNodes) return "its body has " + to_string(size) + " nodes";
+    if (containsCall(*body)) return "it calls a function";
+
+    unordered_set<string> bound;
+    for (size_t i = 0; i + 1 < def.children.size(); i++) {
+        bound.insert(def.children[i]->value);
+    }
+    string missing;
+    for (size_t i = 0; i < body->children.size(); i++) {
+        const Node* statement = body->children[i].get();
+        if (!statement) return "its body failed to parse";
+        const bool last = i + 1 == body->children.size();
+        if (last) {
+            if (statement->type != NodeType::RETURN || statement->children.size() != 1) {
+                return "it does not end in a return";
+            }
+            if (!readsOnly(*statement->children[0], bound, missing)) return "it reads '" + missing + "'";
+        } else {
+            if (statement->type != NodeType::ASSIGN || statement->children.size() != 2 ||
+                statement->children[0]->type != NodeType::VARIABLE) {
+                return "its body is not straight-line assignments";
+            }
+            if (!readsOnly(*statement->children[1], bound, missing)) return "it reads '" + missing + "'";
+            bound.insert(statement->children[0]->value);
+        }
+    }
+    return "";
+}
+
+void renameVariables(Node& node, const string& prefix) {
+    if (node.type == NodeType::VARIABLE) node.value = prefix + node.value;
+    for (auto& child : node.children) {
+        if (child) renameVariables(*child, prefix);
+    }
+}
+
+unique_ptr<Node> renamedCopy(const Node& node, const string& prefix) {
+    unique_ptr<Node> copy(node.clone());
+    renameVariables(*copy, prefix);
+    return copy;
+}
+
+class Inliner {
+   private:
+    unordered_map<string, const Node*> candidates;  // Inlinable top-level functions by name
+    unordered_set<string> defined;                  // Candidates whose DEF has already run
+    vector<string>& report;
+    int nextCall = 0;
+
+    /**
+     * Replaces inlinable calls inside `expression` with the callee's return expression. Arguments and the callee's
+     * assignments go to `prelude` as statements on renamed locals, to run just before the enclosing statement.
+     */
+    void inlineIn(unique_ptr<Node>& expression, vector<unique_ptr<Node>>& prelude) {
+        if (!expression) return;
+        if (expression->type != NodeType::FUNC_CALL) {
+            for (auto& child : expression->children) {
+                inlineIn(child, prelude);
+            }
+            return;
+        }
+
+        Node& call = *expression;
+        auto candidate = candidates.find(call.value);
+        if (candidate == candidates.end() || !defined.count(call.value)) return;
+        const Node& def = *candidate->second;
+        if (call.children.size() != def.children.size() - 1) return;
+        for (const auto& arg : call.children) {
+            if (!arg || containsCall(*arg)) return;
+        }
+
+        const string prefix = "$inl" + to_string(nextCall++) + "_";
+        for (size_t i = 0; i < call.children.size(); i++) {
+            auto bind = make_unique<Node>(NodeType::ASSIGN, call.token, "=");
+            bind->addChild(make_unique<Node>(NodeType::VARIABLE, call.token, prefix + def.children[i]->value));
+            bind->addChild(move(call.children[i]));
+            prelude.push_back(move(bind));
+        }
+        const Node& body = *def.children.back();
+        for (size_t i = 0; i + 1 < body.children.size(); i++) {
+            prelude.push_back(renamedCopy(*body.children[i], prefix));
+        }
+
+        report.push_back("line " + to_string(call.token.lineNumber) + ": inlined " + call.value);
+        expression = renamedCopy(*body.children.back()->children[0], prefix);
+    }
+
+    /**
+     * Inlines in a statement list. Only expressions evaluated exactly once each time their statement runs are
+     * touched; while conditions run once per iteration and are left alone.
+     */
+    void inlineInStatements(vector<unique_ptr<Node>>& statements) {
+        for (size_t i = 0; i < statements.size(); i++) {
+            Node* statement = statements[i].get();
+            if (!statement) continue;
+
+            vector<unique_ptr<Node>> prelude;
+            switch (statement->type) {
+                case NodeType::ASSIGN:
+                case NodeType::COMPOUND_ASSIGN:
+                    if (statement->children.size() >= 2) inlineIn(statement->children[1], prelude);
+                    break;
+
+                case NodeType::PRINT:
+                case NodeType::RETURN:
+                    if (!statement->children.empty()) inlineIn(statement->children[0], prelude);
+                    break;
+
+                case NodeType::IF:
+                    if (!statement->children.empty()) inlineIn(statement->children[0], prelude);
+                    if (statement->children.size() > 1 && statement->children[1]) {
+                        inlineInStatements(statement->children[1]->children);
+                    }
+                    break;
+
+                case NodeType::WHILE:
+                    if (statement->children.size() > 1 && statement->children[1]) {
+                        inlineInStatements(statement->children[1]->children);
+                    }
+                    break;
+
+                case NodeType::FOR:
+                    // The range is evaluated once, before the body
+                    for (size_t bound = 0; bound + 1 < statement->children.size(); bound++) {
+                        inlineIn(statement->children[bound], prelude);
+                    }
+                    if (statement->children.back()) inlineInStatements(statement->children.back()->children);
+                    break;
+
+                case NodeType::DEF:
+                    // Calls inside function bodies fail at runtime and are left to do so
+                    if (candidates.count(statement->value)) defined.insert(statement->value);
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (!prelude.empty()) {
+                const size_t count = prelude.size();
+                statements.insert(statements.begin() + i, make_move_iterator(prelude.begin()),
+                                  make_move_iterator(prelude.end()));
+                i += count;
+            }
+        }
+    }
+
+   public:
+    explicit Inliner(vector<string>& report) : report(report) {}
+
+    void run(Node& program) {
+        unordered_map<string, int> definitions;
+        countDefinitions(program, definitions);
+        for (const auto& statement : program.children) {
+            if (!statement || statement->type != NodeType::DEF) continue;
+            string reason = definitions[statement->value] > 1 ? "it is defined more than once" : rejectReason(*statement);
+            if (reason.empty()) {
+                candidates[statement->value] = statement.get();
+            } else {
+                report.push_back("line " + to_string(statement->token.lineNumber) + ": not inlining " +
+                                 statement->value + ", " + reason);
+            }
+        }
+        if (!candidates.empty()) inlineInStatements(program.children);
+    }
+};
+}  // namespace
+
+/**
+ * Copies small top-level functions into their callers. A call is replaced by the callee's return expression, with
+ * parameters and locals renamed to `$inl` variables assigned just before the calling statement. Only calls that
+ * certainly reach the function at runtime are inlined: top-level code after its DEF, outside function bodies.
+ * Returns one line per inlined call and per function that was not eligible.
+ */
+vector<string> inlineFunctions(Node& program) {
+    vector<string> report;
+    Inliner(report).run(program);
+    return report;
+}
+}  // namespace optimizer
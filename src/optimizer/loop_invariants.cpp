@@ -0,0 +1,178 @@
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "src/interpreter/natives.hpp"
+#include "src/optimizer/optimizer.hpp"
+
+using namespace std;
+
+namespace optimizer {
+// Arrays are values, so an index assignment can only change the array it names
+void collectAssigned(const Node& node, unordered_set<string>& assigned) {
+    if (node.type == NodeType::DEF) return;  // Function bodies run in their own frame
+    if (node.type == NodeType::FOR) assigned.insert(node.value);
+    if ((node.type == NodeType::ASSIGN || node.type == NodeType::COMPOUND_ASSIGN) && node.children.size() >= 2) {
+        // m[i][j] = x writes the matrix m
+        const Node* target = node.children[0].get();
+        while (target->type == NodeType::INDEX) target = target->children[0].get();
+        if (target->type == NodeType::VARIABLE) assigned.insert(target->value);
+    }
+    if (node.type == NodeType::FUNC_CALL) {
+        // sort(a) updates a in place
+        const Native* native = NativeRegistry::instance().find(node.value);
+        if (native && native->mutatesArrays) {
+            for (const auto& argument : node.children) {
+                if (argument && argument->type == NodeType::VARIABLE) assigned.insert(argument->value);
+            }
+        }
+    }
+    for (const auto& child : node.children) {
+        if (child) collectAssigned(*child, assigned);
+    }
+}
+
+namespace {
+using Names = unordered_set<string>;
+
+bool containsCall(const Node& node) {
+    if (node.type == NodeType::FUNC_CALL) return true;
+    for (const auto& child : node.children) {
+        if (child && containsCall(*child)) return true;
+    }
+    return false;
+}
+
+// Expressions worth a temporary. Calls are never hoisted since they may print
+bool isCompound(const Node& node) {
+    return node.type == NodeType::OPERATOR || node.type == NodeType::CONDITIONAL || node.type == NodeType::INDEX ||
+           node.type == NodeType::ARRAY;
+}
+
+bool isInvariant(const Node& node, const Names& assigned) {
+    if (node.type == NodeType::NUMBER) return true;
+    if (node.type == NodeType::VARIABLE) return assigned.count(node.value) == 0;
+    if (!isCompound(node)) return false;
+    for (const auto& child : node.children) {
+        if (!child || !isInvariant(*child, assigned)) return false;
+    }
+    return true;
+}
+
+class Hoister {
+   private:
+    int nextTemporary = 0;
+
+    // Moves the largest invariant subexpressions of `expression` into `hoisted` and reads temporaries instead
+    void hoistFrom(unique_ptr<Node>& expression, const Names& assigned, vector<unique_ptr<Node>>& hoisted) {
+        if (!expression || !isCompound(*expression)) return;
+        if (!isInvariant(*expression, assigned)) {
+            for (auto& child : expression->children) {
+                hoistFrom(child, assigned, hoisted);
+            }
+            return;
+        }
+
+        const Token token = expression->token;
+        const string name = "$licm" + to_string(nextTemporary++);
+        auto assign = make_unique<Node>(NodeType::ASSIGN, token, "=");
+        assign->addChild(make_unique<Node>(NodeType::VARIABLE, token, name));
+        assign->addChild(move(expression));
+        hoisted.push_back(move(assign));
+        expression = make_unique<Node>(NodeType::VARIABLE, token, name);
+    }
+
+    /**
+     * Hoists from the parts of a loop body statement that run on every iteration. Nested blocks may not run, and an
+     * assignment's index is skipped when the array is missing, so those are left alone.
+     */
+    void hoistFromStatement(Node& statement, const Names& assigned, vector<unique_ptr<Node>>& hoisted) {
+        switch (statement.type) {
+            case NodeType::ASSIGN:
+            case NodeType::COMPOUND_ASSIGN:
+                if (statement.children.size() >= 2) hoistFrom(statement.children[1], assigned, hoisted);
+                return;
+
+            case NodeType::PRINT:
+            case NodeType::RETURN:
+            case NodeType::IF:
+            case NodeType::WHILE:
+                if (!statement.children.empty()) hoistFrom(statement.children[0], assigned, hoisted);
+                return;
+
+            default:
+                return;
+        }
+    }
+
+    /**
+     * Rewrites `while (c): body` as `if c: temporaries, while (c): body` with invariant expressions read from the
+     * temporaries. The guard keeps loops that never run from evaluating anything they would not have.
+     */
+    void hoistLoop(unique_ptr<Node>& slot) {
+        Node& loop = *slot;
+        if (loop.children.size() < 2 || !loop.children[0] || !loop.children[1]) return;
+        // The guard evaluates the condition one extra time, which must not be observable
+        if (containsCall(*loop.children[0])) return;
+
+        Names assigned;
+        collectAssigned(loop, assigned);
+
+        auto guardCondition = unique_ptr<Node>(loop.children[0]->clone());
+        vector<unique_ptr<Node>> hoisted;
+        hoistFrom(loop.children[0], assigned, hoisted);
+        for (auto& statement : loop.children[1]->children) {
+            if (!statement) continue;
+            hoistFromStatement(*statement, assigned, hoisted);
+            if (statement->type == NodeType::RETURN) break;
+        }
+        if (hoisted.empty()) return;
+
+        auto block = make_unique<Node>(NodeType::BLOCK, loop.token, "BLOCK");
+        for (auto& assign : hoisted) {
+            block->addChild(move(assign));
+        }
+        block->addChild(move(slot));
+
+        auto guard = make_unique<Node>(NodeType::IF, block->children.back()->token, "if");
+        guard->addChild(move(guardCondition));
+        guard->addChild(move(block));
+        slot = move(guard);
+    }
+
+   public:
+    /**
+     * Hoists in every loop among `statements`, innermost loops first. A loop whose value is the value of its block
+     * is left alone, since the guarding IF would evaluate to 0 instead.
+     */
+    void hoistIn(vector<unique_ptr<Node>>& statements, bool valueUsed) {
+        for (size_t i = 0; i < statements.size(); i++) {
+            auto& statement = statements[i];
+            if (!statement) continue;
+
+            switch (statement->type) {
+                case NodeType::IF:
+                case NodeType::WHILE:
+                case NodeType::FOR:
+                case NodeType::DEF:
+                    if (!statement->children.empty() && statement->children.back()) {
+                        hoistIn(statement->children.back()->children, statement->type != NodeType::IF);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if (statement->type == NodeType::WHILE && !(valueUsed && i + 1 == statements.size())) {
+                hoistLoop(statement);
+            }
+        }
+    }
+};
+}  // namespace
+
+/**
+ * Loop-invariant code motion. Expressions in a while loop's condition and unconditional body statements whose
+ * variables are never assigned inside the loop are computed once into `$licm` temporaries before the loop.
+ */
+void hoistLoopInvariants(Node& program) { Hoister().hoistIn(program.children, false); }
+}  // namespace optimizer
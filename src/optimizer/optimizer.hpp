@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "src/parser/parser.hpp"
+
+namespace optimizer {
+void analyzeScopes(Node& program);
+void hoistLoopInvariants(Node& program);
+void eliminateCommonSubexpressions(Node& program);
+void shareConstantArrays(Node& program);
+std::vector<std::string> inlineFunctions(Node& program);
+
+// What inferTypes proved, one line per fact, and the reads it could not type with the reason
+struct TypeReport {
+    std::vector<std::string> facts;
+    std::vector<std::string> failures;
+};
+
+TypeReport inferTypes(Node& program);
+
+// Every variable assigned anywhere inside `node`, including arrays updated through an index or passed to a native that
+// changes them in place. Function bodies run in their own frame and are skipped
+void collectAssigned(const Node& node, std::unordered_set<std::string>& assigned);
+}  // namespace optimizer
@@ -0,0 +1,80 @@
+#include <string>
+#include <unordered_set>
+
+#include "src/optimizer/optimizer.hpp"
+
+using namespace std;
+
+namespace optimizer {
+namespace {
+using Names = unordered_set<string>;
+
+void analyzeBlock(Node& block, Names visible);
+
+/**
+ * Tracks the variables a statement declares in the current scope and analyzes any blocks nested inside it.
+ * `visible` holds names that are guaranteed to exist in this scope or an enclosing one at this point, since
+ * Scope::update only declares a variable when no enclosing scope has it yet.
+ */
+void analyzeStatement(Node& statement, Names& visible, bool& declaresVariable) {
+    switch (statement.type) {
+        case NodeType::ASSIGN: {
+            // Assignments whose right side failed to parse are skipped at runtime
+            if (statement.children.size() < 2) return;
+            const Node& target = *statement.children[0];
+            if (target.type == NodeType::VARIABLE && visible.insert(target.value).second) {
+                declaresVariable = true;
+            }
+            return;
+        }
+
+        case NodeType::IF:
+        case NodeType::WHILE:
+            if (statement.children.size() > 1 && statement.children[1]) {
+                analyzeBlock(*statement.children[1], visible);
+            }
+            return;
+
+        case NodeType::FOR:
+            // The loop variable is declared in the enclosing scope before the body first runs
+            if (visible.insert(statement.value).second) declaresVariable = true;
+            if (!statement.children.empty() && statement.children.back()) {
+                analyzeBlock(*statement.children.back(), visible);
+            }
+            return;
+
+        case NodeType::DEF: {
+            // Function bodies run in a fresh interpreter where only the parameters exist
+            Names params;
+            for (size_t i = 0; i + 1 < statement.children.size(); i++) {
+                params.insert(statement.children[i]->value);
+            }
+            if (!statement.children.empty()) analyzeBlock(*statement.children.back(), params);
+            return;
+        }
+
+        default:
+            return;
+    }
+}
+
+void analyzeBlock(Node& block, Names visible) {
+    bool declaresVariable = false;
+    for (auto& statement : block.children) {
+        if (statement) analyzeStatement(*statement, visible, declaresVariable);
+    }
+    block.needsScope = declaresVariable;
+}
+}  // namespace
+
+/**
+ * Marks every BLOCK that never declares a variable so the interpreter can run it in the enclosing scope
+ */
+void analyzeScopes(Node& program) {
+    Names globals;
+    bool declaresVariable = false;
+    for (auto& statement : program.children) {
+        if (statement) analyzeStatement(*statement, globals, declaresVariable);
+    }
+}
+}  // namespace optimizer
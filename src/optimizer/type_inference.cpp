@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/interpreter/natives.hpp"
+#include "src/optimizer/optimizer.hpp"
+
+using namespace std;
+
+namespace optimizer {
+namespace {
+// Types are sets of the shapes a value may have at runtime, joined with bitwise or
+enum : unsigned { INT = 1, INT_ARRAY = 2, ARRAY = 4, MATRIX = 8, ANY = INT | INT_ARRAY | ARRAY | MATRIX };
+
+// Mirrors the check pmap and preduce make before running a function body on worker threads
+bool runsInParallel(const Node& node) {
+    if (node.type == NodeType::PRINT || node.type == NodeType::FUNC_CALL || node.type == NodeType::DEF) return false;
+    for (const auto& child : node.children) {
+        if (child && !runsInParallel(*child)) return false;
+    }
+    return true;
+}
+
+// Names the optimizer introduces start with '$', which scripts cannot use
+bool isTemporary(const string& name) { return !name.empty() && name[0] == '$'; }
+
+StaticType toStaticType(unsigned type) {
+    if (type == INT) return StaticType::INT;
+    if (type == MATRIX) return StaticType::MATRIX;
+    if (type != 0 && (type & (INT | MATRIX)) == 0) return StaticType::ARRAY;
+    return StaticType::UNKNOWN;
+}
+
+string typeName(unsigned type) {
+    switch (type) {
+        case 0:
+            return "unused";
+        case INT:
+            return "int";
+        case INT_ARRAY:
+            return "int array";
+        case ARRAY:
+        case INT_ARRAY | ARRAY:
+            return "array";
+        case MATRIX:
+            return "matrix";
+        default:
+            return type & MATRIX ? "matrix or other" : "int or array";
+    }
+}
+
+// What is known at one program point: variable types and the functions that are certainly defined
+struct State {
+    unordered_map<string, unsigned> variables;
+    unordered_set<string> functions;
+};
+
+struct Summary {
+    vector<Node*> definitions;  // Every top-level DEF with this name
+    bool conflicting = false;   // Definitions disagree on the parameter count, so nothing is known about calls
+    vector<unsigned> params;
+    unsigned returns = 0;
+    map<string, unsigned> locals;
+};
+
+class Inference {
+   private:
+    unordered_map<string, Summary> functions;
+    map<string, unsigned> globals;
+    set<pair<int, string>> failures;
+    bool changed = false;
+    bool reportFailures = true;  // Off inside functions that are never called, such as ones inlined everywhere
+
+    struct Context {
+        bool inFunction;
+        map<string, unsigned>* assigned;  // Every type a name is assigned in this frame, for the report
+    };
+
+    void widen(unsigned& slot, unsigned type) {
+        if ((slot | type) != slot) {
+            slot |= type;
+            changed = true;
+        }
+    }
+
+    unsigned readVariable(Node& node, const State& state, const Context& context) {
+        auto found = state.variables.find(node.value);
+        unsigned type;
+        if (found != state.variables.end()) {
+            type = found->second;
+        } else {
+            // Undefined reads report an error and yield 0, but top-level names may be bound by the host
+            type = context.inFunction ? INT : ANY;
+        }
+        node.staticType = toStaticType(type);
+        if (node.staticType == StaticType::UNKNOWN && reportFailures) {
+            failures.insert({node.token.lineNumber, found == state.variables.end()
+                                                        ? "'" + node.value + "' is read before it is assigned"
+                                                        : "'" + node.value + "' may be " + typeName(type)});
+        }
+        return type;
+    }
+
+    // A type of 0 is a function result not known yet during the fixpoint, and stays unknown through arrays. Indexing
+    // a matrix gives one of its rows, or 0 after an error
+    unsigned elementsOf(unsigned arrayType) {
+        if (arrayType == INT_ARRAY) return INT;
+        if (arrayType & MATRIX) return arrayType & ~(INT | MATRIX) ? ANY : INT_ARRAY | INT;
+        return arrayType == 0 ? 0 : ANY;
+    }
+
+    unsigned arrayOf(unsigned elementType) { return elementType == INT ? INT_ARRAY : elementType == 0 ? 0 : ARRAY; }
+
+    // Result of calling a native, which is 0 when its arguments are rejected
+    unsigned nativeCall(const Native& native, Node& node, const vector<unsigned>& args, State& state,
+                        const Context& context) {
+        if (native.mutatesArrays && !native.preservesElements) {
+            // An Array& parameter may get elements of any shape
+            for (size_t i = 0; i < node.children.size(); i++) {
+                const Node* arg = node.children[i].get();
+                if (arg && arg->type == NodeType::VARIABLE && (args[i] & INT_ARRAY)) {
+                    assign(arg->value, args[i] | ARRAY, state, context);
+                }
+            }
+        }
+        switch (native.returns) {
+            case StaticType::INT:
+                return INT;
+            case StaticType::ARRAY:
+                return INT | INT_ARRAY | ARRAY;
+            case StaticType::MATRIX:
+                return INT | MATRIX;
+            default:
+                return ANY;
+        }
+    }
+
+    unsigned call(Node& node, State& state, const Context& context) {
+        const bool parallel = (node.value == "pmap" && node.children.size() == 2) ||
+                              (node.value == "preduce" && node.children.size() == 3);
+        vector<unsigned> args;
+        for (size_t i = 0; i < node.children.size(); i++) {
+            // The function argument of pmap and preduce names a function and is never evaluated
+            args.push_back(parallel && i == 0 ? ANY : operand(node.children[i], state, context));
+        }
+        // Natives run anywhere a script function of the same name has not been defined
+        const Native* native = NativeRegistry::instance().find(node.value);
+        const unsigned undefinedCall = native ? nativeCall(*native, node, args, state, context) : INT;
+
+        // Function frames start with an empty function table, so calls from inside a function fail
+        if (context.inFunction) return undefinedCall;
+
+        auto found = functions.find(node.value);
+        if (found != functions.end()) {
+            Summary& summary = found->second;
+            if (summary.conflicting) return ANY;
+            if (args.size() != summary.params.size()) return INT;
+            for (size_t i = 0; i < args.size(); i++) {
+                widen(summary.params[i], args[i]);
+            }
+            return state.functions.count(node.value) ? summary.returns : summary.returns | undefinedCall;
+        }
+
+        if (parallel) {
+            if (!node.children[0]) return ANY;
+            const Node& funcArg = *node.children[0];
+            auto mapped = functions.find(funcArg.value);
+            if (funcArg.type != NodeType::VARIABLE || mapped == functions.end() || mapped->second.conflicting) {
+                return ANY;
+            }
+            Summary& summary = mapped->second;
+            const bool isMap = node.value == "pmap";
+            const unsigned element = elementsOf(args[1]);
+            if (summary.params.size() != (isMap ? 1 : 2)) return INT;
+            if (isMap) {
+                widen(summary.params[0], element);
+            } else {
+                widen(summary.params[0], element | args[2] | summary.returns);
+                widen(summary.params[1], element);
+            }
+
+            // The builtins report an error and return 0 unless all of these hold at runtime
+            const bool checked = state.functions.count(funcArg.value) && (args[1] & INT) == 0 &&
+                                 all_of(summary.definitions.begin(), summary.definitions.end(),
+                                        [](const Node* def) {
+                                            return def->children.back() && runsInParallel(*def->children.back());
+                                        });
+            const unsigned failure = checked ? 0 : INT;
+            if (isMap) return failure | arrayOf(summary.returns);
+            return failure | args[2] | summary.returns;
+        }
+        return undefinedCall;  // Natives, checkpoint() and calls to undefined functions
+    }
+
+    unsigned expression(Node& node, State& state, const Context& context) {
+        unsigned type = ANY;
+        switch (node.type) {
+            case NodeType::NUMBER:
+            case NodeType::STRING:  // Natives read strings from the node; evaluating one anywhere else gives 0
+                type = INT;
+                break;
+
+            case NodeType::VARIABLE:
+                return readVariable(node, state, context);
+
+            case NodeType::OPERATOR:
+            case NodeType::CONDITIONAL: {
+                unsigned operands = 0;
+                for (auto& child : node.children) {
+                    operands |= operand(child, state, context);
+                }
+                // Arithmetic on a matrix is element-wise; anything else that is not int reports an error and gives 0
+                type = node.type == NodeType::OPERATOR && (operands & MATRIX) ? INT | MATRIX : INT;
+                break;
+            }
+
+            case NodeType::ARRAY: {
+                unsigned elements = node.children.empty() ? INT : 0;
+                for (auto& child : node.children) {
+                    elements |= operand(child, state, context);
+                }
+                type = arrayOf(elements);
+                break;
+            }
+
+            case NodeType::INDEX: {
+                if (node.children.size() < 2) break;
+                const unsigned base = operand(node.children[0], state, context);
+                operand(node.children[1], state, context);
+                type = elementsOf(base);
+                break;
+            }
+
+            case NodeType::FUNC_CALL:
+                type = call(node, state, context);
+                break;
+
+            default:
+                break;
+        }
+        node.staticType = toStaticType(type);
+        return type;
+    }
+
+    // The parser leaves a null child behind after a syntax error, which evaluates to 0
+    unsigned operand(unique_ptr<Node>& child, State& state, const Context& context) {
+        return child ? expression(*child, state, context) : INT;
+    }
+
+    // An element assignment target `name[index]`, or null for anything else
+    static Node* indexedVariable(const unique_ptr<Node>& target) {
+        if (!target || target->type != NodeType::INDEX || target->children.size() < 2) return nullptr;
+        const unique_ptr<Node>& base = target->children[0];
+        return base && base->type == NodeType::VARIABLE ? base.get() : nullptr;
+    }
+
+    void assign(const string& name, unsigned type, State& state, const Context& context) {
+        state.variables[name] = type;
+        (*context.assigned)[name] |= type;
+    }
+
+    unsigned statement(Node& node, State& state, const Context& context) {
+        switch (node.type) {
+            case NodeType::ASSIGN: {
+                if (node.children.size() < 2) return INT;
+                const unsigned value = operand(node.children[1], state, context);
+                if (!node.children[0]) return value | INT;
+                Node& target = *node.children[0];
+                if (target.type == NodeType::VARIABLE) {
+                    assign(target.value, value, state, context);
+                    return value;
+                }
+                if (Node* base = indexedVariable(node.children[0])) {
+                    const unsigned arrayType = readVariable(*base, state, context);
+                    operand(target.children[1], state, context);
+                    if ((arrayType & INT_ARRAY) && value != INT) {
+                        assign(base->value, (arrayType & ~INT_ARRAY) | ARRAY, state, context);
+                    }
+                }
+                return value | INT;
+            }
+
+            case NodeType::COMPOUND_ASSIGN: {
+                // Only an int variable or int element can be updated, and it stays an int
+                if (node.children.size() < 2) return INT;
+                operand(node.children[1], state, context);
+                const unique_ptr<Node>& target = node.children[0];
+                if (target && target->type == NodeType::VARIABLE) {
+                    readVariable(*target, state, context);
+                } else if (Node* base = indexedVariable(target)) {
+                    readVariable(*base, state, context);
+                    operand(target->children[1], state, context);
+                }
+                node.staticType = StaticType::INT;
+                return INT;
+            }
+
+            case NodeType::PRINT:
+                if (!node.children.empty()) operand(node.children[0], state, context);
+                return INT;
+
+            case NodeType::RETURN:
+                return node.children.empty() ? INT : operand(node.children[0], state, context);
+
+            case NodeType::IF: {
+                if (node.children.size() < 2) return INT;
+                operand(node.children[0], state, context);
+                State body = state;
+                if (node.children[1]) block(*node.children[1], body, context);
+                join(state, body);
+                return INT;
+            }
+
+            case NodeType::WHILE: {
+                // Iterate to a fixpoint so the last pass annotates the body with the types every iteration sees
+                if (node.children.size() < 2 || !node.children[1]) return INT;
+                unsigned last = INT;
+                State entry = state;
+                while (true) {
+                    operand(node.children[0], entry, context);
+                    State body = entry;
+                    last = block(*node.children[1], body, context);
+                    State next = entry;
+                    join(next, body);
+                    if (next.variables == entry.variables) break;
+                    entry = move(next);
+                }
+                state = move(entry);
+                return INT | last;
+            }
+
+            case NodeType::FOR: {
+                if (node.children.empty() || !node.children.back()) return INT;
+                for (size_t i = 0; i + 1 < node.children.size(); i++) {
+                    operand(node.children[i], state, context);
+                }
+                // The loop variable is an int at the start of every iteration, whatever the body assigns to it
+                assign(node.value, INT, state, context);
+                unsigned last = INT;
+                State entry = state;
+                while (true) {
+                    State body = entry;
+                    body.variables[node.value] = INT;
+                    last = block(*node.children.back(), body, context);
+                    State next = entry;
+                    join(next, body);
+                    if (next.variables == entry.variables) break;
+                    entry = move(next);
+                }
+                state = move(entry);
+                return INT | last;
+            }
+
+            case NodeType::DEF:
+                if (context.inFunction) {
+                    // Nested definitions are only reachable from their own frame; analyze them without call facts
+                    map<string, unsigned> ignored;
+                    function(node, vector<unsigned>(node.children.size() - 1, ANY), ignored);
+                } else {
+                    state.functions.insert(node.value);
+                }
+                return INT;
+
+            default:
+                return expression(node, state, context);
+        }
+    }
+
+    // Widens `state` with what `other` knows about the names `state` already has
+    void join(State& state, const State& other) {
+        for (auto& variable : state.variables) {
+            auto found = other.variables.find(variable.first);
+            if (found != other.variables.end()) variable.second |= found->second;
+        }
+    }
+
+    /**
+     * Analyzes a block in place on `state` and returns the type of the value the block evaluates to. Names first
+     * assigned inside the block live in the block's scope, so they are forgotten when it ends.
+     */
+    unsigned block(Node& node, State& state, const Context& context) {
+        State inner = state;
+        unsigned result = INT;
+        for (auto& child : node.children) {
+            if (!child) continue;
+            result = statement(*child, inner, context);
+            if (child->type == NodeType::RETURN) break;
+        }
+        for (auto& variable : state.variables) {
+            variable.second = inner.variables[variable.first];
+        }
+        state.functions = move(inner.functions);
+        return result;
+    }
+
+    unsigned function(Node& def, const vector<unsigned>& params, map<string, unsigned>& locals) {
+        State state;
+        for (size_t i = 0; i + 1 < def.children.size(); i++) {
+            // Parameters of a function not called yet are unconstrained short of matrices: a call passing one
+            // widens the parameter, and the body is analyzed again
+            state.variables[def.children[i]->value] = params[i] == 0 ? ANY & ~MATRIX : params[i];
+        }
+        Context context{true, &locals};
+        return block(*def.children.back(), state, context);
+    }
+
+    void collectFunctions(Node& node) {
+        if (node.type == NodeType::DEF) {
+            Summary& summary = functions[node.value];
+            if (!summary.definitions.empty() && summary.params.size() != node.children.size() - 1) {
+                summary.conflicting = true;
+            }
+            summary.definitions.push_back(&node);
+            summary.params.assign(node.children.size() - 1, 0);
+            return;  // Definitions inside functions are never visible to top-level calls
+        }
+        for (auto& child : node.children) {
+            if (child) collectFunctions(*child);
+        }
+    }
+
+   public:
+    TypeReport run(Node& program) {
+        collectFunctions(program);
+
+        // Only widen() sets `changed`, and it only adds bits to function summaries. Each round but the last adds at
+        // least one of the four bits per parameter or result, so the loop ends after at most that many rounds
+        do {
+            changed = false;
+            globals.clear();
+            failures.clear();
+
+            State state;
+            Context context{false, &globals};
+            for (auto& child : program.children) {
+                if (!child) continue;
+                statement(*child, state, context);
+                if (child->type == NodeType::RETURN) break;
+            }
+
+            for (auto& entry : functions) {
+                Summary& summary = entry.second;
+                summary.locals.clear();
+                for (Node* def : summary.definitions) {
+                    vector<unsigned> params = summary.params;
+                    if (summary.conflicting) params.assign(def->children.size() - 1, ANY);
+                    reportFailures = params.empty() ||
+                                     any_of(params.begin(), params.end(), [](unsigned type) { return type != 0; });
+                    widen(summary.returns, function(*def, params, summary.locals));
+                    reportFailures = true;
+                }
+            }
+        } while (changed);
+        return report();
+    }
+
+   private:
+    TypeReport report() {
+        TypeReport result;
+        for (const auto& global : globals) {
+            if (isTemporary(global.first)) continue;
+            result.facts.push_back(global.first + ": " + typeName(global.second));
+        }
+
+        map<string, const Summary*> sorted;
+        for (const auto& entry : functions) {
+            sorted[entry.first] = &entry.second;
+        }
+        for (const auto& entry : sorted) {
+            const Summary& summary = *entry.second;
+            const Node& def = *summary.definitions.front();
+            string signature = entry.first + "(";
+            for (size_t i = 0; i + 1 < def.children.size(); i++) {
+                if (i > 0) signature += ", ";
+                signature += def.children[i]->value + ": " + typeName(summary.params[i]);
+            }
+            result.facts.push_back(signature + ") -> " + typeName(summary.returns));
+            for (const auto& local : summary.locals) {
+                if (local.second == 0 || isTemporary(local.first)) continue;
+                result.facts.push_back(entry.first + "." + local.first + ": " + typeName(local.second));
+            }
+        }
+
+        for (const auto& failure : failures) {
+            result.failures.push_back("line " + to_string(failure.first) + ": " + failure.second);
+        }
+        return result;
+    }
+};
+}  // namespace
+
+/**
+ * Proves which variables, parameters and function results are int-only or array-only and records the facts in
+ * Node::staticType for the interpreter's specialized paths. Analysis is flow-sensitive: a variable may be an int
+ * in one part of a script and an array in another. Parameter types are the join of every call site, so the whole
+ * program is re-analyzed until function summaries stop growing.
+ */
+TypeReport inferTypes(Node& program) { return Inference().run(program); }
+}  // namespace optimizer
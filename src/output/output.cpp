@@ -0,0 +1,72 @@
+#include "src/output/output.hpp"
+
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+OutputSink& OutputSink::standard() {
+    static StdoutSink sink;
+    return sink;
+}
+
+void StdoutSink::write(const char* data, size_t size) {
+    fwrite(data, 1, size, stdout);
+    fflush(stdout);
+}
+
+FileSink::FileSink(const string& path) : file(fopen(path.c_str(), "wb")) {}
+
+FileSink::~FileSink() {
+    if (file) fclose(file);
+}
+
+void FileSink::write(const char* data, size_t size) {
+    if (file) fwrite(data, 1, size, file);
+}
+
+/**
+ * Redirects future output. Anything already buffered goes to the previous sink first
+ */
+void OutputBuffer::setSink(OutputSink& newSink) {
+    if (&newSink == sink) return;
+    flush();
+    sink = &newSink;
+}
+
+void OutputBuffer::write(const char* data, size_t size) {
+    if (size >= capacity) {
+        // Too big to be worth copying, send it straight through
+        flush();
+        sink->write(data, size);
+        return;
+    }
+    memcpy(reserve(size), data, size);
+    used += size;
+}
+
+void OutputBuffer::write(char c) {
+    *reserve(1) = c;
+    ++used;
+}
+
+void OutputBuffer::writeInt(int value) {
+    const size_t maxDigits = 11;  // "-2147483648"
+    char* start = reserve(maxDigits);
+    used += to_chars(start, start + maxDigits, value).ptr - start;
+}
+
+void OutputBuffer::flush() {
+    if (used == 0) return;
+    sink->write(buffer.data(), used);
+    used = 0;
+}
+
+/**
+ * Returns space for `size` more bytes, flushing first if they would not fit
+ */
+char* OutputBuffer::reserve(size_t size) {
+    if (buffer.empty()) buffer.resize(capacity);
+    if (used + size > capacity) flush();
+    return buffer.data() + used;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Destination for script output. Sinks only ever see whole buffers, never single PRINT lines.
+ */
+class OutputSink {
+   public:
+    virtual ~OutputSink() = default;
+    virtual void write(const char* data, size_t size) = 0;
+
+    static OutputSink& standard();  // Process-wide stdout sink
+};
+
+class StdoutSink : public OutputSink {
+   public:
+    void write(const char* data, size_t size) override;
+};
+
+class FileSink : public OutputSink {
+   private:
+    FILE* file;
+
+   public:
+    explicit FileSink(const std::string& path);
+    ~FileSink();
+    bool isOpen() const { return file != nullptr; }
+    void write(const char* data, size_t size) override;
+};
+
+// In-memory capture for tests and embedders
+class StringSink : public OutputSink {
+   public:
+    std::string text;
+    void write(const char* data, size_t size) override { text.append(data, size); }
+};
+
+/**
+ * Batches PRINT output in a reusable buffer and hands it to the sink when it fills up, on flush() or on
+ * destruction. The buffer is allocated on first write, so unused OutputBuffers cost nothing.
+ */
+class OutputBuffer {
+   private:
+    static constexpr size_t capacity = 64 * 1024;
+
+    OutputSink* sink;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+   public:
+    explicit OutputBuffer(OutputSink& sink = OutputSink::standard()) : sink(&sink) {}
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void setSink(OutputSink& newSink);
+    void write(const char* data, size_t size);
+    void write(char c);
+    void writeInt(int value);
+    void flush();
+
+   private:
+    char* reserve(size_t size);
+};
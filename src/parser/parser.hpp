@@ -4,6 +4,8 @@
 #include <vector>
 
 #include "src/lexer/Lexer.hpp"
+#include "src/memory/memory.hpp"
+#include "src/scope/value.hpp"
 
 enum class NodeType {
     PROGRAM,
@@ -11,8 +13,10 @@ enum class NodeType {
     RETURN,
     PARAM,
     WHILE,
+    FOR,
     FUNC_CALL,
     ASSIGN,
+    COMPOUND_ASSIGN,  // target op= value, with the arithmetic operator ("+", "-", "*" or "/") as the value
     PRINT,
     BLOCK,
     IF,
@@ -21,18 +25,31 @@ enum class NodeType {
     VARIABLE,
     ARRAY,
     INDEX,
-    NUMBER
+    NUMBER,
+    STRING  // Only valid as an argument to a native, which reads the text from the node
 };
 
+// Shape of every value a node can produce, as proven by optimizer::inferTypes
+enum class StaticType { UNKNOWN, INT, ARRAY, MATRIX };
+
 struct Node {
     NodeType type;
     Token token;
     std::string value;
+    int number = 0;          // NUMBER literals are decoded once by the parser
+    bool needsScope = true;  // Cleared by optimizer::analyzeScopes on BLOCKs that never declare a variable
+    StaticType staticType = StaticType::UNKNOWN;
+    SharedArray constant;    // Set by optimizer::shareConstantArrays on ARRAY literals whose elements are all constants
 
     std::vector<std::unique_ptr<Node>> children;
 
     void addChild(std::unique_ptr<Node> child) { children.push_back(std::move(child)); }
 
+    // AST nodes count towards the active MemoryTracker like Arrays and Scopes do. Defined in parser_core.cpp, since
+    // GCC takes the inlined ::operator new for a mismatch with this operator delete
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+
     Node() {}
 
     Node(NodeType type, std::string value) {
@@ -52,6 +69,9 @@ struct Node {
         newNode->type = this->type;
         newNode->value = this->value;
         newNode->token = this->token;
+        newNode->number = this->number;
+        newNode->needsScope = this->needsScope;
+        newNode->staticType = this->staticType;
 
         // Clone all children recursively
         for (const auto& child : this->children) {
@@ -66,12 +86,12 @@ struct Node {
 
 class Parser {
    private:
+    // Per-instance sentinels rather than function-local statics, so parsers on different threads share nothing
+    const std::vector<Token> noTokens;
+    const Token eofToken{TokenType::_EOF, "EOF"};
     const std::vector<Token>* tokensRef = nullptr;
 
-    const std::vector<Token>& getTokens() const {
-        static const std::vector<Token> empty{};
-        return tokensRef ? *tokensRef : empty;
-    }
+    const std::vector<Token>& getTokens() const { return tokensRef ? *tokensRef : noTokens; }
 
     size_t tokenLength = 0;
     size_t tokenPosition = 0;
@@ -91,6 +111,7 @@ class Parser {
     std::unique_ptr<Node> parseBlockUntil(TokenType terminator);
     std::unique_ptr<Node> parseFunction();
     std::unique_ptr<Node> parseWhile();
+    std::unique_ptr<Node> parseFor();
     std::unique_ptr<Node> parseFunctionCall();
     std::unique_ptr<Node> parseIndex(std::unique_ptr<Node>& varNode);
     std::unique_ptr<Node> parseIndexExpr();
@@ -103,6 +124,7 @@ class Parser {
     std::unique_ptr<Node> parseTerm();
     std::unique_ptr<Node> parseReturn();
     std::unique_ptr<Node> parseIndexAccess(bool allowAssignment);
+    std::unique_ptr<Node> parseCompoundAssign(std::unique_ptr<Node> target);
     std::unique_ptr<Node> parseFactor();
     std::unique_ptr<Node> parseArray();
 };
@@ -4,6 +4,16 @@
 
 using namespace std;
 
+void* Node::operator new(size_t size) {
+    if (MemoryTracker* tracker = MemoryTracker::active()) tracker->charge(size);
+    return ::operator new(size);
+}
+
+void Node::operator delete(void* p, size_t size) {
+    if (MemoryTracker* tracker = MemoryTracker::active()) tracker->release(size);
+    ::operator delete(p, size);
+}
+
 /* Checks current token for provided type. Returns true/false if so */
 bool Parser::match(TokenType type) {
     if (tokenPosition < tokenLength && getTokens()[tokenPosition].type == type) {
@@ -25,7 +35,6 @@ bool Parser::consume(TokenType type, const string& what) {
 
 /* Returns Reference to current token without advancing position*/
 Token const& Parser::peek() const {
-    static const Token eofToken{TokenType::_EOF, "EOF"};
     if (tokenPosition < tokenLength) {
         return getTokens()[tokenPosition];
     }
@@ -34,7 +43,6 @@ Token const& Parser::peek() const {
 
 /* Returns last consumed token or EOF */
 Token const& Parser::current() const {
-    static const Token eofToken{TokenType::_EOF, "EOF"};
     if (tokenPosition == 0) return eofToken;  // nothing consumed yet
     size_t tokenIndex = tokenPosition - 1;
     if (tokenIndex < tokenLength) return getTokens()[tokenIndex];  // last consumed token
@@ -43,7 +51,6 @@ Token const& Parser::current() const {
 
 /* Returns current token then advances position*/
 Token Parser::advance() {
-    static const Token eofToken{TokenType::_EOF, "EOF"};
     if (tokenPosition < tokenLength) {
         return getTokens()[tokenPosition++];  // return current token then advance
     }
@@ -1,3 +1,4 @@
+#include <charconv>
 #include <iostream>
 
 #include "src/parser/parser.hpp"
@@ -65,7 +66,18 @@ unique_ptr<Node> Parser::parseFactor() {
         return parseArray();
     } else if (type == TokenType::NUMBER) {
         auto numToken = advance();
-        return make_unique<Node>(NodeType::NUMBER, numToken, numToken.value);
+        auto numberNode = make_unique<Node>(NodeType::NUMBER, numToken, numToken.value);
+
+        // The lexer only emits digits, so the only way decoding fails is a literal that does not fit in an int
+        const char* end = numToken.value.data() + numToken.value.size();
+        if (from_chars(numToken.value.data(), end, numberNode->number).ec != errc()) {
+            cerr << "Error: Number out of range '" << numToken.value << "' at line " << numToken.lineNumber << "\n";
+            return nullptr;
+        }
+        return numberNode;
+    } else if (type == TokenType::STRING) {
+        auto stringToken = advance();
+        return make_unique<Node>(NodeType::STRING, stringToken, stringToken.value);
     } else if (type == TokenType::IDENTIFIER) {
         bool allowAssignment = false;
         return parseIdentifier(allowAssignment);
@@ -4,6 +4,13 @@
 
 using namespace std;
 
+namespace {
+bool isCompoundAssign(TokenType type) {
+    return type == TokenType::PLUS_ASSIGN || type == TokenType::SUBTRACT_ASSIGN ||
+           type == TokenType::MULTIPLY_ASSIGN || type == TokenType::DIVIDE_ASSIGN;
+}
+}  // namespace
+
 unique_ptr<Node> Parser::parseStatement() {
     // Skip newlines
     while (match(TokenType::NEWLINE));
@@ -42,6 +49,11 @@ unique_ptr<Node> Parser::parseStatement() {
             return parseWhile();
         }
 
+        case TokenType::FOR: {
+            advance();
+            return parseFor();
+        }
+
         case TokenType::RETURN: {
             return parseReturn();
         }
@@ -77,6 +89,49 @@ unique_ptr<Node> Parser::parseWhile() {
     return whileStmt;
 }
 
+/**
+ * Parses `for name in range(start, end[, step]):` followed by an indented block. The FOR node's value is the loop
+ * variable and its children are start, end, step and the body; a missing step becomes the literal 1.
+ */
+unique_ptr<Node> Parser::parseFor() {
+    const auto forToken = current();  // Already consumed
+    if (!consume(TokenType::IDENTIFIER, "loop variable")) return nullptr;
+    auto forStmt = make_unique<Node>(NodeType::FOR, forToken, current().value);
+
+    if (!consume(TokenType::IN, "in")) return nullptr;
+    if (!consume(TokenType::IDENTIFIER, "range") || current().value != "range") {
+        cerr << "Expected range(...) after 'in' at line " << forToken.lineNumber << "\n";
+        return nullptr;
+    }
+    if (!consume(TokenType::LPAREN, "(")) return nullptr;
+
+    // Bounds and step
+    while (forStmt->children.size() < 3) {
+        auto bound = parseExpression();
+        if (!bound) return nullptr;
+        forStmt->addChild(move(bound));
+        if (!match(TokenType::COMMA)) break;
+    }
+    if (forStmt->children.size() < 2) {
+        cerr << "range() needs a start and an end at line " << forToken.lineNumber << "\n";
+        return nullptr;
+    }
+    if (forStmt->children.size() == 2) {
+        auto step = make_unique<Node>(NodeType::NUMBER, forToken, "1");
+        step->number = 1;
+        forStmt->addChild(move(step));
+    }
+
+    if (!consume(TokenType::RPAREN, ")")) return nullptr;
+    if (!consume(TokenType::COLON, ":")) return nullptr;
+
+    // Consume any newLines
+    while (match(TokenType::NEWLINE));
+
+    forStmt->addChild(parseIndentedBlock());
+    return forStmt;
+}
+
 unique_ptr<Node> Parser::parseIf() {
     // If was already consumed so current
     const auto ifToken = current();
@@ -146,7 +201,8 @@ unique_ptr<Node> Parser::parseIndexExpr() {
 // Parses a index access node
 unique_ptr<Node> Parser::parseIndex(unique_ptr<Node>& varNode) {
     // parse indexExpr and create index node and return
-    auto indexNode = make_unique<Node>(NodeType::INDEX, "index");
+    // The '[' token gives index errors a line number
+    auto indexNode = make_unique<Node>(NodeType::INDEX, peek(), "index");
     auto index = parseIndexExpr();
 
     indexNode->addChild(move(varNode));
@@ -170,8 +226,9 @@ unique_ptr<Node> Parser::parseIdentifier(bool allowAssignment) {
     }
 
     // Else we just assign the variable to a regular assignment
-    auto assignNode = make_unique<Node>(NodeType::ASSIGN, idToken.value);
+    auto assignNode = make_unique<Node>(NodeType::ASSIGN, idToken, idToken.value);
     auto variable = make_unique<Node>(NodeType::VARIABLE, idToken, idToken.value);
+    if (isCompoundAssign(peek().type)) return parseCompoundAssign(move(variable));
     assignNode->addChild(move(variable));
 
     if (consume(TokenType::ASSIGN, "=")) {
@@ -184,9 +241,23 @@ unique_ptr<Node> Parser::parseIdentifier(bool allowAssignment) {
     return move(assignNode);
 }
 
+// Parses the operator and value of `target op= value`, where target is a variable or an array element
+unique_ptr<Node> Parser::parseCompoundAssign(unique_ptr<Node> target) {
+    const Token opToken = advance();
+    auto assignNode = make_unique<Node>(NodeType::COMPOUND_ASSIGN, opToken, opToken.value.substr(0, 1));
+    auto value = parseExpression();
+    if (!value) {
+        cerr << "Error: Missing value after '" << opToken.value << "' at line " << opToken.lineNumber << "\n";
+        return nullptr;
+    }
+    assignNode->addChild(move(target));
+    assignNode->addChild(move(value));
+    return assignNode;
+}
+
 unique_ptr<Node> Parser::parseReturn() {
-    advance();
-    auto returnStmt = make_unique<Node>(NodeType::RETURN, "RETURN");
+    const Token returnToken = advance();
+    auto returnStmt = make_unique<Node>(NodeType::RETURN, returnToken, "RETURN");
 
     unique_ptr<Node> expression = parseExpression();
     if (expression) {
@@ -200,8 +271,11 @@ unique_ptr<Node> Parser::parseIndexAccess(bool allowAssignment) {
     // Create a variable node first
     auto varNode = make_unique<Node>(NodeType::VARIABLE, idToken, idToken.value);
 
-    // Parse the index to create index node
+    // Parse the index to create index node; further indexes like `m[i][j]` wrap it
     auto indexNode = parseIndex(varNode);
+    while (peek().type == TokenType::LSQUARE) indexNode = parseIndex(indexNode);
+
+    if (allowAssignment && isCompoundAssign(peek().type)) return parseCompoundAssign(move(indexNode));
 
     // If assignment follows, create assign node with index as left child
     if (allowAssignment && peek().type == TokenType::ASSIGN) {
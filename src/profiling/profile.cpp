@@ -0,0 +1,51 @@
+#include "src/profiling/profile.hpp"
+
+#include <cstdio>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+string escapeJson(const string& text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        escaped += c;
+    }
+    return escaped;
+}
+}  // namespace
+
+void Trace::add(const string& name, const char* category, Clock::time_point start, Clock::time_point end) {
+    using Micros = chrono::duration<double, micro>;
+    events.push_back({name, category, Micros(start - origin).count(), Micros(end - start).count()});
+}
+
+bool Trace::write(const string& path) const {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+    fputs("{\"traceEvents\":[\n", file);
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& event = events[i];
+        fprintf(file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+                escapeJson(event.name).c_str(), event.category, event.start, event.duration,
+                i + 1 < events.size() ? "," : "");
+    }
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+    return fclose(file) == 0;
+}
+
+void Profile::print(ostream& out) const {
+    out << left << setw(10) << "Phase" << right << setw(12) << "Time (ms)" << setw(14) << "Allocations" << "\n";
+    for (const auto& phase : phases) {
+        out << left << setw(10) << phase.name << right << setw(12) << fixed << setprecision(3) << phase.milliseconds
+            << setw(14) << phase.allocations << "\n";
+    }
+    out << "Tokens: " << tokens << "\n";
+    out << "AST nodes: " << astNodes << "\n";
+    out << "Scope pushes: " << scopePushes << "\n";
+    out << "Variable lookups: " << variableLookups << "\n";
+    out << "Function calls: " << functionCalls << "\n";
+    out << "Pool hits: " << poolHits << ", misses: " << poolMisses << "\n";
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Collects Chrome trace-event spans and writes them as JSON that chrome://tracing and Perfetto can open
+ */
+class Trace {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+   private:
+    struct Event {
+        std::string name;
+        const char* category;
+        double start;  // Microseconds since the trace began
+        double duration;
+    };
+
+    Clock::time_point origin = Clock::now();
+    std::vector<Event> events;
+
+   public:
+    void add(const std::string& name, const char* category, Clock::time_point start, Clock::time_point end);
+    bool write(const std::string& path) const;
+};
+
+struct PhaseStats {
+    const char* name;
+    double milliseconds = 0;
+    size_t allocations = 0;  // AST nodes, arrays and scope tables allocated during the phase
+};
+
+/**
+ * Where one run spent its time. Phases are filled in by the executor and the counters by the interpreter, which
+ * only touches them while a Profile is attached.
+ */
+struct Profile {
+    std::vector<PhaseStats> phases;
+    size_t tokens = 0;
+    size_t astNodes = 0;
+    size_t scopePushes = 0;
+    size_t variableLookups = 0;
+    size_t functionCalls = 0;
+    size_t poolHits = 0;  // Array and scope allocations served from an ArrayPool free list
+    size_t poolMisses = 0;
+
+    Trace* trace = nullptr;  // Also record a span per phase and per script function call when set
+
+    void print(std::ostream& out) const;
+};
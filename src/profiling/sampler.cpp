@@ -0,0 +1,127 @@
+#include "src/profiling/sampler.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+using namespace std;
+
+namespace {
+atomic<Sampler*> activeSampler{nullptr};
+
+#ifndef _WIN32
+struct sigaction previousAction;
+#endif
+}  // namespace
+
+ShadowStack::ShadowStack(const string& rootName) {
+    names.push_back(rootName);
+    functions[0].store(0, memory_order_relaxed);
+    for (auto& line : lines) line.store(0, memory_order_relaxed);
+}
+
+void ShadowStack::push(const void* key, const string& name) {
+    auto found = ids.find(key);
+    if (found == ids.end()) {
+        found = ids.emplace(key, static_cast<int>(names.size())).first;
+        names.push_back(name);
+    }
+    const int top = depth.load(memory_order_relaxed);
+    if (top < maxDepth) {
+        functions[top].store(found->second, memory_order_relaxed);
+        lines[top].store(0, memory_order_relaxed);
+    }
+    depth.store(top + 1, memory_order_relaxed);
+}
+
+Sampler::Sampler(const string& rootName, int hertz) : shadow(rootName), hertz(hertz > 0 ? hertz : 1000) {}
+
+Sampler::~Sampler() { stop(); }
+
+// Runs in signal context: only atomics and the preallocated buffer are touched
+void Sampler::onSignal(int) {
+    Sampler* sampler = activeSampler.load(memory_order_relaxed);
+    if (!sampler) return;
+    const size_t slot = sampler->taken.fetch_add(1, memory_order_relaxed);
+    if (slot >= capacity) {
+        sampler->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    const ShadowStack& shadow = sampler->shadow;
+    Sample& sample = sampler->samples[slot];
+    const int depth = shadow.depth.load(memory_order_relaxed);
+    sample.depth = depth < ShadowStack::maxDepth ? depth : ShadowStack::maxDepth;
+    for (int i = 0; i < sample.depth; i++) {
+        sample.functions[i] = shadow.functions[i].load(memory_order_relaxed);
+        sample.lines[i] = shadow.lines[i].load(memory_order_relaxed);
+    }
+}
+
+#ifndef _WIN32
+bool Sampler::start() {
+    Sampler* expected = nullptr;
+    if (!activeSampler.compare_exchange_strong(expected, this)) {
+        cerr << "ERROR: Another sampling profiler is already running" << endl;
+        return false;
+    }
+    samples.reset(new Sample[capacity]);
+
+    struct sigaction action = {};
+    action.sa_handler = onSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &previousAction);
+
+    itimerval timer = {};
+    const long interval = 1000000L / hertz;
+    timer.it_interval.tv_sec = interval / 1000000L;
+    timer.it_interval.tv_usec = interval % 1000000L;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    running = true;
+    return true;
+}
+
+void Sampler::stop() {
+    if (!running) return;
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previousAction, nullptr);
+    activeSampler.store(nullptr);
+    running = false;
+}
+#else
+bool Sampler::start() {
+    cerr << "ERROR: --sample-profile needs SIGPROF, which this build does not support" << endl;
+    return false;
+}
+
+void Sampler::stop() {}
+#endif
+
+bool Sampler::writeFolded(const string& path) const {
+    ofstream out(path);
+    if (!out) return false;
+
+    map<string, size_t> stacks;
+    const size_t count = sampleCount();
+    for (size_t i = 0; i < count; i++) {
+        const Sample& sample = samples[i];
+        string stack;
+        for (int frame = 0; frame < sample.depth; frame++) {
+            if (frame > 0) stack += ';';
+            stack += shadow.names[sample.functions[frame]] + ":" + to_string(sample.lines[frame]);
+        }
+        stacks[stack]++;
+    }
+    for (const auto& stack : stacks) {
+        out << stack.first << " " << stack.second << "\n";
+    }
+    return static_cast<bool>(out);
+}
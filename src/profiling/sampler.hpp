@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The script-level call stack of one interpreter thread: which functions are running and the line each one is on.
+ * Frames are plain atomics so a signal handler can copy them at any moment. Function names are interned to ids when
+ * pushed, which keeps the handler from touching strings.
+ */
+class ShadowStack {
+   public:
+    static const int maxDepth = 32;  // Deeper frames are counted but not recorded
+
+   private:
+    std::atomic<int> depth{1};
+    std::atomic<int> functions[maxDepth];
+    std::atomic<int> lines[maxDepth];
+
+    std::unordered_map<const void*, int> ids;  // Interned names keyed by their DEF node
+    std::vector<std::string> names;
+
+    friend class Sampler;
+
+   public:
+    explicit ShadowStack(const std::string& rootName);
+
+    void push(const void* key, const std::string& name);
+    void pop() { depth.fetch_sub(1, std::memory_order_relaxed); }
+    void setLine(size_t line) {
+        const int top = depth.load(std::memory_order_relaxed) - 1;
+        if (top < maxDepth) lines[top].store(static_cast<int>(line), std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Statistical profiler. While started, a SIGPROF timer fires `hertz` times per second of CPU time and copies the
+ * shadow stack into a preallocated buffer; nothing is measured between samples. Only one sampler may run at once.
+ */
+class Sampler {
+   private:
+    struct Sample {
+        int depth;
+        int functions[ShadowStack::maxDepth];
+        int lines[ShadowStack::maxDepth];
+    };
+
+    static const size_t capacity = 1 << 15;  // About half a minute of CPU time at 1000 Hz
+
+    ShadowStack shadow;
+    int hertz;
+    std::unique_ptr<Sample[]> samples;
+    std::atomic<size_t> taken{0};
+    std::atomic<size_t> dropped{0};
+    bool running = false;
+
+    static void onSignal(int);
+
+   public:
+    Sampler(const std::string& rootName, int hertz);
+    ~Sampler();
+
+    Sampler(const Sampler&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
+
+    ShadowStack& stack() { return shadow; }
+    size_t sampleCount() const { return taken.load() < capacity ? taken.load() : capacity; }
+    size_t droppedCount() const { return dropped.load(); }
+
+    // Returns false after reporting why if sampling is not available
+    bool start();
+    void stop();
+
+    /**
+     * Writes one line per distinct stack, root first: `script:12;fib:3;fib:4 57`, which flamegraph.pl, speedscope
+     * and inferno read directly
+     */
+    bool writeFolded(const std::string& path) const;
+};
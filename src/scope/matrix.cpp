@@ -0,0 +1,101 @@
+#include "src/scope/matrix.hpp"
+
+#include <algorithm>
+
+#include "src/concurrency/thread_pool.hpp"
+
+using namespace std;
+
+namespace matrix {
+namespace {
+// Tile edge in elements; three 64x64 int tiles fit comfortably in L2
+const int tile = 64;
+
+// Products with fewer multiply-adds than this stay on the calling thread
+const size_t parallelWork = size_t(1) << 22;
+
+template <class Op>
+bool apply(char op, size_t count, Op element) {
+    switch (op) {
+        case '+':
+            for (size_t i = 0; i < count; i++) element(i, [](int l, int r) { return l + r; });
+            return true;
+        case '-':
+            for (size_t i = 0; i < count; i++) element(i, [](int l, int r) { return l - r; });
+            return true;
+        case '*':
+            for (size_t i = 0; i < count; i++) element(i, [](int l, int r) { return l * r; });
+            return true;
+        case '/':
+            for (size_t i = 0; i < count; i++) element(i, [](int l, int r) { return l / r; });
+            return true;
+        default:
+            return false;
+    }
+}
+}  // namespace
+
+Matrix multiply(const Matrix& a, const Matrix& b) {
+    const int rows = a.rows();
+    const int inner = a.cols();
+    const int cols = b.cols();
+    Matrix product(rows, cols);
+
+    auto rowTile = [&](size_t tileIndex) {
+        const int rowStart = static_cast<int>(tileIndex) * tile;
+        const int rowEnd = min(rowStart + tile, rows);
+        for (int kk = 0; kk < inner; kk += tile) {
+            const int kEnd = min(kk + tile, inner);
+            for (int jj = 0; jj < cols; jj += tile) {
+                const int jEnd = min(jj + tile, cols);
+                for (int i = rowStart; i < rowEnd; i++) {
+                    int* __restrict out = product.row(i);
+                    const int* aRow = a.row(i);
+                    for (int k = kk; k < kEnd; k++) {
+                        const int scale = aRow[k];
+                        const int* __restrict bRow = b.row(k);
+                        for (int j = jj; j < jEnd; j++) out[j] += scale * bRow[j];
+                    }
+                }
+            }
+        }
+    };
+
+    const size_t tiles = (rows + tile - 1) / tile;
+    if (size_t(rows) * inner * cols >= parallelWork && tiles > 1) {
+        ThreadPool::shared().parallelFor(tiles, rowTile);
+    } else {
+        for (size_t t = 0; t < tiles; t++) rowTile(t);
+    }
+    return product;
+}
+
+Matrix transpose(const Matrix& m) {
+    Matrix result(m.cols(), m.rows());
+    for (int ii = 0; ii < m.rows(); ii += tile) {
+        for (int jj = 0; jj < m.cols(); jj += tile) {
+            const int iEnd = min(ii + tile, m.rows());
+            const int jEnd = min(jj + tile, m.cols());
+            for (int i = ii; i < iEnd; i++) {
+                for (int j = jj; j < jEnd; j++) result.at(j, i) = m.at(i, j);
+            }
+        }
+    }
+    return result;
+}
+
+bool elementwise(char op, const int* left, const int* right, int* out, size_t count) {
+    if (op == '/' && any_of(right, right + count, [](int r) { return r == 0; })) return false;
+    return apply(op, count, [&](size_t i, auto f) { out[i] = f(left[i], right[i]); });
+}
+
+bool elementwise(char op, const int* left, int right, int* out, size_t count) {
+    if (op == '/' && right == 0) return false;
+    return apply(op, count, [&](size_t i, auto f) { out[i] = f(left[i], right); });
+}
+
+bool elementwise(char op, int left, const int* right, int* out, size_t count) {
+    if (op == '/' && any_of(right, right + count, [](int r) { return r == 0; })) return false;
+    return apply(op, count, [&](size_t i, auto f) { out[i] = f(left, right[i]); });
+}
+}  // namespace matrix
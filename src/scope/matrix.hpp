@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "src/memory/memory.hpp"
+
+/**
+ * Row-major grid of ints in a single allocation. The grid sits behind one pointer so a Value holding a Matrix is no
+ * larger than one holding an Array; copies are still deep, like every other script value.
+ */
+class Matrix {
+   private:
+    struct Grid {
+        int rows;
+        int cols;
+        std::vector<int, TrackingAllocator<int>> cells;
+    };
+
+    std::unique_ptr<Grid> grid;
+
+   public:
+    Matrix(int rows, int cols) : grid(new Grid{rows, cols, {}}) { grid->cells.assign(size_t(rows) * cols, 0); }
+    Matrix(const Matrix& other) : grid(new Grid(*other.grid)) {}
+    Matrix(Matrix&&) = default;
+    Matrix& operator=(const Matrix& other) {
+        grid.reset(new Grid(*other.grid));
+        return *this;
+    }
+    Matrix& operator=(Matrix&&) = default;
+
+    int rows() const { return grid->rows; }
+    int cols() const { return grid->cols; }
+    size_t size() const { return grid->cells.size(); }
+    bool contains(int row, int col) const { return row >= 0 && row < grid->rows && col >= 0 && col < grid->cols; }
+
+    int* data() { return grid->cells.data(); }
+    const int* data() const { return grid->cells.data(); }
+    int* row(int r) { return data() + size_t(r) * grid->cols; }
+    const int* row(int r) const { return data() + size_t(r) * grid->cols; }
+    int& at(int r, int c) { return row(r)[c]; }
+    int at(int r, int c) const { return row(r)[c]; }
+};
+
+namespace matrix {
+/**
+ * a * b for a.cols() == b.rows(). Tiles of both operands are kept in cache, the innermost loop runs along contiguous
+ * rows so the compiler can vectorize it, and large products split their row tiles over the shared thread pool.
+ */
+Matrix multiply(const Matrix& a, const Matrix& b);
+
+Matrix transpose(const Matrix& m);
+
+// Applies an arithmetic operator ('+', '-', '*' or '/') element by element; false on division by zero
+bool elementwise(char op, const int* left, const int* right, int* out, size_t count);
+bool elementwise(char op, const int* left, int right, int* out, size_t count);
+bool elementwise(char op, int left, const int* right, int* out, size_t count);
+}  // namespace matrix
@@ -7,6 +7,37 @@
  */
 Scope* Scope::getParent() { return parent; }
 
+/**
+ * Removes every variable declared in this scope. Their map entries are kept, so a loop body that declares the same
+ * variables on every iteration does not allocate them again
+ */
+void Scope::clear() {
+    while (!variables.empty()) {
+        spareNodes.push_back(variables.extract(variables.begin()));
+        spareNodes.back().mapped() = Value();
+    }
+}
+
+/**
+ * Frees the entries kept by clear()
+ */
+void Scope::releaseSpareNodes() { spareNodes.clear(); }
+
+/**
+ * Adds a variable to this scope, in a spare entry when there is one
+ */
+void Scope::declare(const std::string& variableName, const Value& value) {
+    if (spareNodes.empty()) {
+        variables.emplace(variableName, value);
+        return;
+    }
+    Variables::node_type node = std::move(spareNodes.back());
+    spareNodes.pop_back();
+    node.key() = variableName;
+    node.mapped() = value;
+    variables.insert(std::move(node));
+}
+
 /**
  *  Updates variable in the scope. if not found adds new variable to map
  */
@@ -26,11 +57,11 @@ void Scope::update(const std::string& variableName, const Value value) {
             parent->update(variableName, value);
         } else {
             // Variable doesn't exist anywhere, create in current scope
-            variables[variableName] = value;
+            declare(variableName, value);
         }
     } else {
         // No parent and not in current scope, create it here
-        variables[variableName] = value;
+        declare(variableName, value);
     }
 }
 
@@ -63,4 +94,14 @@ std::pair<bool, Value> Scope::lookup(const std::string& name) {
         return parent->lookup(name);
     }
     return {false, 0};
-}
\ No newline at end of file
+}
+/**
+ * Looks up a variable in this scope or parents without copying it. Returns nullptr if it is not declared
+ */
+Value* Scope::find(const std::string& name) {
+    for (Scope* scope = this; scope; scope = scope->parent) {
+        auto it = scope->variables.find(name);
+        if (it != scope->variables.end()) return &it->second;
+    }
+    return nullptr;
+}
@@ -1,20 +1,37 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "src/memory/memory.hpp"
 #include "src/scope/value.hpp"
 
 class Scope {
    private:
-    std::unordered_map<std::string, Value> variables;
+    using Variables = std::unordered_map<std::string, Value, std::hash<std::string>, std::equal_to<std::string>,
+                                         TrackingAllocator<std::pair<const std::string, Value>>>;
+    Variables variables;
+    std::vector<Variables::node_type> spareNodes;  // Entries of cleared variables, reused by the next declarations
     Scope* parent;
 
+    void declare(const std::string& variableName, const Value& value);
+
    public:
     Scope(Scope* p = nullptr) : parent(p) {};
 
     Scope* getParent();
+    void setParent(Scope* p) { parent = p; }
+    void clear();
+    void releaseSpareNodes();
 
     void updateArr(const std::string& variableName, const int index, const Value& value);
     void update(const std::string& variableName, const Value value);
     std::pair<bool, Value> lookup(const std::string& name);
+    Value* find(const std::string& name);
+
+    // Calls f(name, value) for every variable declared directly in this scope
+    template <class F>
+    void forEach(F f) const {
+        for (const auto& variable : variables) f(variable.first, variable.second);
+    }
 };
\ No newline at end of file
@@ -1,19 +1,40 @@
 #pragma once
+#include <memory>
 #include <variant>
 #include <vector>
 
+#include "src/memory/memory.hpp"
+#include "src/scope/matrix.hpp"
+
 struct Value;
-using Array = std::vector<Value>;
+using Array = std::vector<Value, TrackingAllocator<Value>>;
+
+// An array built once, such as a literal of constants, shared by every value holding it until one writes to it
+using SharedArray = std::shared_ptr<const Array>;
 
 struct Value {
-    std::variant<int, Array> v;
+    std::variant<int, Array, Matrix, SharedArray> v;
     Value() : v(0) {}
     Value(int i) : v(i) {}
     Value(const Array& a) : v(a) {}
+    Value(Array&& a) : v(std::move(a)) {}
+    Value(const Matrix& m) : v(m) {}
+    Value(Matrix&& m) : v(std::move(m)) {}
+    Value(SharedArray a) : v(std::move(a)) {}
 
     bool isInt() const { return std::holds_alternative<int>(v); }
-    bool isArray() const { return std::holds_alternative<Array>(v); }
+    bool isArray() const { return std::holds_alternative<Array>(v) || std::holds_alternative<SharedArray>(v); }
+    bool isMatrix() const { return std::holds_alternative<Matrix>(v); }
     int asInt() const { return std::get<int>(v); }
-    Array& asArray() { return std::get<Array>(v); }
-    const Array& asArray() const { return std::get<Array>(v); }
+    // Copy on write: mutable access first gives the value its own copy of a shared array
+    Array& asArray() {
+        if (const SharedArray* shared = std::get_if<SharedArray>(&v)) v = Array(**shared);
+        return std::get<Array>(v);
+    }
+    const Array& asArray() const {
+        if (const SharedArray* shared = std::get_if<SharedArray>(&v)) return **shared;
+        return std::get<Array>(v);
+    }
+    Matrix& asMatrix() { return std::get<Matrix>(v); }
+    const Matrix& asMatrix() const { return std::get<Matrix>(v); }
 };
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "src/server/server.hpp"
+
+#include <iostream>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "src/concurrency/thread_pool.hpp"
+#include "src/executor/executor.hpp"
+#include "src/utility/utility.hpp"
+#endif
+
+using namespace std;
+
+namespace server {
+#ifndef _WIN32
+namespace {
+struct CachedProgram {
+    long long modified;
+    shared_ptr<const executor::Program> program;
+};
+
+// Inline sources are cached by their text, up to this many distinct scripts
+const size_t maxCachedSources = 256;
+
+mutex cacheMutex;
+unordered_map<string, CachedProgram> pathCache;
+unordered_map<string, shared_ptr<const executor::Program>> sourceCache;
+
+long long modifiedNanos(const struct stat& info) {
+#ifdef __APPLE__
+    return info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    return info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+}
+
+/**
+ * Returns the compiled program for a file, recompiling only when its modification time changed
+ */
+shared_ptr<const executor::Program> programForPath(const string& path, string& error) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        error = "Cannot open " + path;
+        return nullptr;
+    }
+    const long long modified = modifiedNanos(info);
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto cached = pathCache.find(path);
+        if (cached != pathCache.end() && cached->second.modified == modified) {
+            return cached->second.program;
+        }
+    }
+
+    auto program = executor::compile(utility::readFile(path));
+    lock_guard<mutex> lock(cacheMutex);
+    pathCache[path] = {modified, program};
+    return program;
+}
+
+shared_ptr<const executor::Program> programForSource(const string& source) {
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto cached = sourceCache.find(source);
+        if (cached != sourceCache.end()) return cached->second;
+    }
+
+    auto program = executor::compile(source);
+    lock_guard<mutex> lock(cacheMutex);
+    if (sourceCache.size() >= maxCachedSources) sourceCache.clear();
+    sourceCache[source] = program;
+    return program;
+}
+
+string formatValue(const Value& value) {
+    if (value.isInt()) return to_string(value.asInt());
+    if (value.isMatrix()) {
+        // Rows nest like an array of arrays
+        const Matrix& m = value.asMatrix();
+        string text = "[";
+        for (int r = 0; r < m.rows(); r++) {
+            text += r > 0 ? ",[" : "[";
+            for (int c = 0; c < m.cols(); c++) {
+                if (c > 0) text += ",";
+                text += to_string(m.at(r, c));
+            }
+            text += "]";
+        }
+        return text + "]";
+    }
+    string text = "[";
+    const auto& arr = value.asArray();
+    for (size_t i = 0; i < arr.size(); i++) {
+        if (i > 0) text += ",";
+        text += formatValue(arr[i]);
+    }
+    return text + "]";
+}
+
+string readAll(int fd) {
+    string data;
+    char buffer[4096];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        data.append(buffer, count);
+    }
+    return data;
+}
+
+bool writeAll(int fd, const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t count = write(fd, data.data() + written, data.size() - written);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        written += count;
+    }
+    return true;
+}
+
+bool parseBinding(const string& name, const string& text, executor::Bindings& bindings) {
+    if (name.empty() || text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long value = strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) return false;
+    bindings[name] = static_cast<int>(value);
+    return true;
+}
+
+string handleRequest(const string& requestText) {
+    executor::Bindings bindings;
+    shared_ptr<const executor::Program> program;
+    string error;
+
+    size_t position = 0;
+    while (position < requestText.size() && !program) {
+        size_t lineEnd = requestText.find('\n', position);
+        if (lineEnd == string::npos) lineEnd = requestText.size();
+        const string line = requestText.substr(position, lineEnd - position);
+        position = lineEnd + 1;
+
+        if (line.rfind("ARG ", 0) == 0) {
+            const size_t split = line.find(' ', 4);
+            if (split == string::npos || !parseBinding(line.substr(4, split - 4), line.substr(split + 1), bindings)) {
+                return "ERROR Invalid argument '" + line.substr(4) + "'\n";
+            }
+        } else if (line.rfind("PATH ", 0) == 0) {
+            program = programForPath(line.substr(5), error);
+            if (!program) return "ERROR " + error + "\n";
+        } else if (line == "SOURCE") {
+            program = programForSource(position < requestText.size() ? requestText.substr(position) : "");
+        } else {
+            return "ERROR Unknown request line '" + line + "'\n";
+        }
+    }
+    if (!program) return "ERROR Request has no PATH or SOURCE\n";
+
+    StringSink output;
+    Value result = executor::run(*program, bindings, output);
+    return "OK " + formatValue(result) + "\n" + output.text;
+}
+
+int connectTo(const string& socketPath, bool listening) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "ERROR: Socket path is too long: " << socketPath << endl;
+        return -1;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        cerr << "ERROR: Cannot create socket: " << strerror(errno) << endl;
+        return -1;
+    }
+
+    int status;
+    if (listening) {
+        unlink(socketPath.c_str());
+        status = ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        if (status == 0) status = listen(fd, SOMAXCONN);
+    } else {
+        status = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    }
+    if (status != 0) {
+        cerr << "ERROR: Cannot " << (listening ? "listen on " : "connect to ") << socketPath << ": " << strerror(errno)
+             << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+}  // namespace
+
+int serve(const string& socketPath) {
+    signal(SIGPIPE, SIG_IGN);
+    int listener = connectTo(socketPath, true);
+    if (listener < 0) return 1;
+
+    // Connections get their own pool so long scripts never starve pmap/preduce on the shared one
+    ThreadPool pool(thread::hardware_concurrency());
+    cerr << "Serving on " << socketPath << endl;
+
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            cerr << "ERROR: accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        pool.submit([client] {
+            string response;
+            // A failing script must not take the daemon down with it
+            try {
+                response = handleRequest(readAll(client));
+            } catch (const exception& e) {
+                response = "ERROR " + string(e.what()) + "\n";
+            }
+            writeAll(client, response);
+            close(client);
+        });
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    return 1;
+}
+
+int request(const string& socketPath, const string& script, const vector<string>& args) {
+    string requestText;
+    for (const auto& arg : args) {
+        const size_t split = arg.find('=');
+        if (split == string::npos || split == 0) {
+            cerr << "ERROR: Arguments must look like name=value, got '" << arg << "'" << endl;
+            return 1;
+        }
+        requestText += "ARG " + arg.substr(0, split) + " " + arg.substr(split + 1) + "\n";
+    }
+
+    if (script == "-") {
+        requestText += "SOURCE\n" + string(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+    } else {
+        // The daemon has its own working directory, so send an absolute path
+        char resolved[PATH_MAX];
+        if (!realpath(script.c_str(), resolved)) {
+            cerr << "Failed to open file: " << script << endl;
+            return 1;
+        }
+        requestText += "PATH " + string(resolved) + "\n";
+    }
+
+    int fd = connectTo(socketPath, false);
+    if (fd < 0) return 1;
+    writeAll(fd, requestText);
+    shutdown(fd, SHUT_WR);
+    const string response = readAll(fd);
+    close(fd);
+
+    const size_t lineEnd = response.find('\n');
+    const string status = response.substr(0, lineEnd);
+    if (status.rfind("OK ", 0) != 0) {
+        cerr << (status.rfind("ERROR ", 0) == 0 ? "ERROR: " + status.substr(6) : "ERROR: Bad reply from server")
+             << endl;
+        return 1;
+    }
+
+    const string value = status.substr(3);
+    if (lineEnd != string::npos) cout << response.substr(lineEnd + 1);
+    cout << "Script returned " << value;
+    return value.empty() || value[0] == '[' ? 0 : atoi(value.c_str());
+}
+#else
+int serve(const string& socketPath) {
+    cerr << "ERROR: --serve needs Unix domain sockets, which this build does not support" << endl;
+    return 1;
+}
+
+int request(const string& socketPath, const string& script, const vector<string>& args) {
+    cerr << "ERROR: --client needs Unix domain sockets, which this build does not support" << endl;
+    return 1;
+}
+#endif
+}  // namespace server
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+ * Resident interpreter daemon. One request per connection over a Unix domain socket:
+ *
+ *   ARG <name> <int>        zero or more global bindings
+ *   PATH <script path>      run a file, compiled programs are cached by path and mtime
+ *   SOURCE                  or run the inline source that makes up the rest of the request
+ *
+ * The reply is "OK <return value>" followed by everything the script printed, or "ERROR <message>".
+ */
+namespace server {
+int serve(const std::string& socketPath);
+
+// `script` is a file path, or "-" to send stdin as inline source. `args` are name=value bindings
+int request(const std::string& socketPath, const std::string& script, const std::vector<std::string>& args);
+}  // namespace server
@@ -0,0 +1,243 @@
+#include "src/snapshot/snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "src/utility/mapped_file.hpp"
+
+using namespace std;
+
+namespace snapshot {
+namespace {
+const char magic[8] = {'P', 'L', 'C', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t version = 1;
+
+// Value tags. Arrays holding only ints are stored packed so large lookup tables decode in one pass, and matrices as
+// their shape followed by the cells in row-major order
+enum : uint8_t { INT_VALUE = 0, ARRAY_VALUE = 1, INT_ARRAY_VALUE = 2, MATRIX_VALUE = 3 };
+
+/**
+ * Numbers every DEF node in pre-order, which is stable for a given source text
+ */
+void collectDefinitions(const Node& node, vector<const Node*>& definitions) {
+    if (node.type == NodeType::DEF) definitions.push_back(&node);
+    for (const auto& child : node.children) {
+        if (child) collectDefinitions(*child, definitions);
+    }
+}
+
+class Writer {
+   public:
+    string bytes;
+
+    template <class T>
+    void put(T value) {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const string& text) {
+        put<uint32_t>(text.size());
+        bytes += text;
+    }
+
+    void putValue(const Value& value) {
+        if (value.isInt()) {
+            put<uint8_t>(INT_VALUE);
+            put<int32_t>(value.asInt());
+            return;
+        }
+        if (value.isMatrix()) {
+            const Matrix& m = value.asMatrix();
+            put<uint8_t>(MATRIX_VALUE);
+            put<int32_t>(m.rows());
+            put<int32_t>(m.cols());
+            bytes.append(reinterpret_cast<const char*>(m.data()), m.size() * sizeof(int32_t));
+            return;
+        }
+        const Array& arr = value.asArray();
+        bool onlyInts = true;
+        for (const auto& element : arr) {
+            if (!element.isInt()) {
+                onlyInts = false;
+                break;
+            }
+        }
+        put<uint8_t>(onlyInts ? INT_ARRAY_VALUE : ARRAY_VALUE);
+        put<uint32_t>(arr.size());
+        for (const auto& element : arr) {
+            if (onlyInts) {
+                put<int32_t>(element.asInt());
+            } else {
+                putValue(element);
+            }
+        }
+    }
+};
+
+/**
+ * Bounds-checked cursor over the mapped bytes. Reads past the end leave `failed` set and return zeros.
+ */
+class Reader {
+   private:
+    const char* data;
+    size_t size;
+    size_t position = 0;
+
+   public:
+    bool failed = false;
+
+    Reader(const char* data, size_t size) : data(data), size(size) {}
+
+    bool has(size_t count) {
+        if (failed || size - position < count) failed = true;
+        return !failed;
+    }
+
+    template <class T>
+    T get() {
+        T value{};
+        if (!has(sizeof(T))) return value;
+        memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    string getString() {
+        const uint32_t length = get<uint32_t>();
+        if (!has(length)) return "";
+        string text(data + position, length);
+        position += length;
+        return text;
+    }
+
+    Value getValue() {
+        const uint8_t tag = get<uint8_t>();
+        if (tag == INT_VALUE) return get<int32_t>();
+        if (tag == MATRIX_VALUE) return getMatrix();
+
+        const uint32_t count = get<uint32_t>();
+        // Every element takes at least four bytes, which also stops a corrupt count from reserving gigabytes
+        if (tag > INT_ARRAY_VALUE || !has(size_t(count) * 4)) {
+            failed = true;
+            return 0;
+        }
+        Array arr;
+        arr.reserve(count);
+        for (uint32_t i = 0; i < count && !failed; i++) {
+            arr.push_back(tag == INT_ARRAY_VALUE ? Value(get<int32_t>()) : getValue());
+        }
+        return Value(move(arr));
+    }
+
+    Value getMatrix() {
+        const int32_t rows = get<int32_t>();
+        const int32_t cols = get<int32_t>();
+        if (rows < 0 || cols < 0 || !has(size_t(rows) * size_t(cols) * 4)) {
+            failed = true;
+            return 0;
+        }
+        Matrix m(rows, cols);
+        memcpy(m.data(), data + position, m.size() * sizeof(int32_t));
+        position += m.size() * sizeof(int32_t);
+        return Value(move(m));
+    }
+};
+}  // namespace
+
+bool write(const string& path, uint64_t fingerprint, uint32_t resumeAt, const Interpreter& interpreter,
+           const Node& program) {
+    Writer writer;
+    writer.bytes.append(magic, sizeof(magic));
+    writer.put<uint32_t>(version);
+    writer.put<uint64_t>(fingerprint);
+    writer.put<uint32_t>(resumeAt);
+
+    uint32_t globalCount = 0;
+    interpreter.globalScope.forEach([&](const string&, const Value&) { globalCount++; });
+    writer.put<uint32_t>(globalCount);
+    interpreter.globalScope.forEach([&](const string& name, const Value& value) {
+        writer.putString(name);
+        writer.putValue(value);
+    });
+
+    vector<const Node*> definitions;
+    collectDefinitions(program, definitions);
+    unordered_map<const Node*, uint32_t> definitionIndex;
+    for (size_t i = 0; i < definitions.size(); i++) {
+        definitionIndex[definitions[i]] = i;
+    }
+    writer.put<uint32_t>(interpreter.functionTable.size());
+    for (const auto& function : interpreter.functionTable) {
+        writer.putString(function.first);
+        writer.put<uint32_t>(definitionIndex.at(function.second));
+    }
+
+    // Write next to the target and rename, so a crash never leaves a half-written snapshot behind
+    const string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        cerr << "ERROR: Cannot write snapshot " << path << endl;
+        return false;
+    }
+    const bool written = fwrite(writer.bytes.data(), 1, writer.bytes.size(), file) == writer.bytes.size();
+    if (fclose(file) != 0 || !written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        remove(temporaryPath.c_str());
+        cerr << "ERROR: Cannot write snapshot " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+long read(const string& path, uint64_t fingerprint, Interpreter& interpreter, const Node& program) {
+    utility::MappedFile file(path);
+    if (!file.isOpen()) {
+        cerr << "ERROR: Cannot open snapshot " << path << endl;
+        return -1;
+    }
+
+    Reader reader(file.data(), file.size());
+    if (!reader.has(sizeof(magic)) || memcmp(file.data(), magic, sizeof(magic)) != 0) {
+        cerr << "ERROR: " << path << " is not a snapshot" << endl;
+        return -1;
+    }
+    reader.get<uint64_t>();  // Skip the magic
+    if (reader.get<uint32_t>() != version) {
+        cerr << "ERROR: Snapshot " << path << " was written by a different version" << endl;
+        return -1;
+    }
+    if (reader.get<uint64_t>() != fingerprint) {
+        cerr << "ERROR: Snapshot " << path << " was taken from a different script" << endl;
+        return -1;
+    }
+    const uint32_t resumeAt = reader.get<uint32_t>();
+
+    const uint32_t globalCount = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < globalCount && !reader.failed; i++) {
+        string name = reader.getString();
+        Value value = reader.getValue();
+        interpreter.globalScope.update(name, value);
+    }
+
+    vector<const Node*> definitions;
+    collectDefinitions(program, definitions);
+    const uint32_t functionCount = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < functionCount && !reader.failed; i++) {
+        string name = reader.getString();
+        const uint32_t index = reader.get<uint32_t>();
+        if (index >= definitions.size()) {
+            reader.failed = true;
+            break;
+        }
+        interpreter.functionTable[name] = definitions[index];
+    }
+
+    if (reader.failed || resumeAt > program.children.size()) {
+        cerr << "ERROR: Snapshot " << path << " is corrupt" << endl;
+        return -1;
+    }
+    return resumeAt;
+}
+}  // namespace snapshot
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "src/interpreter/interpreter.hpp"
+
+/**
+ * Binary snapshots of an interpreter's globals, functions and arrays, taken at a top-level checkpoint() call.
+ * Snapshots use the host's byte order and are only valid for the exact source text they were taken from.
+ */
+namespace snapshot {
+/**
+ * Saves `interpreter`'s global scope and function table. Functions are stored as references into `program`, and
+ * `resumeAt` is the index of the first top-level statement a restored run evaluates. Returns false on I/O errors.
+ */
+bool write(const std::string& path, uint64_t fingerprint, uint32_t resumeAt, const Interpreter& interpreter,
+           const Node& program);
+
+/**
+ * Maps a snapshot and loads it into `interpreter`, whose functions will point into `program`. Returns the index of
+ * the statement to resume from, or -1 after reporting why the snapshot cannot be used.
+ */
+long read(const std::string& path, uint64_t fingerprint, Interpreter& interpreter, const Node& program);
+}  // namespace snapshot
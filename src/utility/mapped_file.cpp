@@ -0,0 +1,64 @@
+#include "src/utility/mapped_file.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace utility {
+MappedFile::MappedFile(const string& path) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                bytes = static_cast<const char*>(address);
+                length = info.st_size;
+                mapped = true;
+            }
+        }
+        close(fd);
+        if (mapped) return;
+    }
+#endif
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return;
+    contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    bytes = contents.data();
+    length = contents.size();
+}
+
+void MappedFile::adviseSequential() {
+#ifndef _WIN32
+    if (mapped) madvise(const_cast<char*>(bytes), length, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::release(size_t offset) {
+#ifndef _WIN32
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t end = min(offset, length) / pageSize * pageSize;
+    if (!mapped || end <= released) return;
+    madvise(const_cast<char*>(bytes) + released, end - released, MADV_DONTNEED);
+    released = end;
+#else
+    (void)offset;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(bytes), length);
+#endif
+}
+}  // namespace utility
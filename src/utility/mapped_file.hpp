@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace utility {
+/**
+ * Read-only view of a whole file. The file is memory mapped where the platform supports it and read into memory
+ * otherwise, so callers never pay for a copy they did not ask for.
+ */
+class MappedFile {
+   private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    size_t released = 0;   // Bytes at the front whose pages were handed back by release()
+    std::string contents;  // Used when the file could not be mapped
+
+   public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return bytes != nullptr; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Hints that the file is read front to back, so the kernel reads ahead of the reader
+    void adviseSequential();
+    // Drops the mapped pages before `offset` from this process; reading them again faults them back in from the file
+    void release(size_t offset);
+};
+}  // namespace utility
@@ -1,8 +1,25 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "src/codegen/cpp_emitter.hpp"
 #include "src/executor/executor.hpp"
+#include "src/executor/scheduler.hpp"
+#include "src/interpreter/interpreter.hpp"
+#include "src/interpreter/natives.hpp"
+#include "src/optimizer/optimizer.hpp"
+#include "src/server/server.hpp"
+#include "src/utility/utility.hpp"
 
 using namespace std;
 
@@ -11,12 +28,76 @@ struct TestCase {
     int expected;
 };
 
+#ifdef _WIN32
+const string nullDevice = "nul";
+const string exeSuffix = ".exe";
+#else
+const string nullDevice = "/dev/null";
+const string exeSuffix = "";
+#endif
+const string quiet = " > " + nullDevice + " 2>&1";
+
+// Compiler for translated scripts, overridable with PLC_CXX. Translations are only built when it can be run
+string translationCompiler() {
+    const char* configured = getenv("PLC_CXX");
+    return configured ? configured : "g++";
+}
+
+// What `main` prints for a script: everything the script printed, then its result
+string interpreterOutput(const executor::Program& program) {
+    StringSink output;
+    executor::RunOptions options;
+    options.output = &output;
+    const Value result = executor::run(program, {}, options).value;
+    ostringstream text;
+    text << output.text;
+    if (result.isArray()) {
+        text << "Script returned array of size " << result.asArray().size();
+    } else if (result.isMatrix()) {
+        text << "Script returned " << result.asMatrix().rows() << "x" << result.asMatrix().cols() << " matrix";
+    } else {
+        text << "Script returned " << result.asInt();
+    }
+    return text.str();
+}
+
+/**
+ * Builds the C++ translation of a script into tests/ and runs it, setting `printed` to its standard output.
+ * Returns false when it does not build
+ */
+bool runTranslation(const string& cpp, const string& stem, string& printed) {
+    const string base = "tests/aot_" + stem;
+    const string source = base + ".cpp", binary = base + exeSuffix, output = base + ".out";
+    ofstream(source) << cpp;
+#ifdef _WIN32
+    const string command = "tests\\aot_" + stem + exeSuffix;
+#else
+    const string command = "./" + binary;
+#endif
+    const bool built = system((translationCompiler() + " -std=c++17 -O1 -I src/codegen " + source + " -o " + binary +
+                               quiet).c_str()) == 0;
+    if (built) {
+        system((command + " > " + output + " 2>" + nullDevice).c_str());
+        printed = utility::readFile(output);
+    }
+    remove(source.c_str());
+    remove(binary.c_str());
+    remove(output.c_str());
+    return built;
+}
+
 int main() {
     string testsDir = "tests/";
     vector<TestCase> tests = {{"test_simple_assign.txt", 12}, {"test_arith.txt", 44},
                               {"test_conditionals.txt", 11},  {"test_nested.txt", 102},
                               {"test_functions.txt", 208},    {"test_scope.txt", 660},
-                            {"test_while.txt", 30}};
+                            {"test_while.txt", 30},         {"test_parallel.txt", 58},
+                              {"test_snapshot.txt", 58},      {"test_licm.txt", 360},
+                              {"test_for.txt", 114},       {"test_compound.txt", 229},
+                              {"test_builtins.txt", 59},       {"test_matrix.txt", 163},
+                              {"test_constant_arrays.txt", 101}, {"test_data.txt", 393},
+                              {"test_cse.txt", 694},          {"test_errors.txt", 0},
+                              {"test_number_range.txt", 12}};
 
     bool allPassed = true;
     for (const auto& test : tests) {
@@ -31,6 +112,481 @@ int main() {
         }
         cout << endl;
     }
+
+    // Run the same scripts concurrently through the batch executor
+    cout << "=== Running batch of " << tests.size() << " scripts ===\n";
+    vector<string> paths;
+    for (const auto& test : tests) {
+        paths.push_back(testsDir + test.filename);
+    }
+    auto results = executor::executeBatch(paths, 4);
+    for (size_t i = 0; i < tests.size(); i++) {
+        if (results[i].value.asInt() != tests[i].expected) {
+            cout << "Batch " << tests[i].filename << " returned " << results[i].value.asInt() << " FAILED!\n";
+            allPassed = false;
+        }
+        if (tests[i].filename == "test_while.txt" && results[i].output.rfind("1\n2\n3\n", 0) != 0) {
+            cout << "Batch output for test_while.txt was not captured FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // A script that throws is reported in its own result and the rest of the batch still runs
+    cout << "=== Running batch with a failing script ===\n";
+    {
+        const string failingPath = testsDir + "test_batch_failing.tmp";
+        ofstream(failingPath) << "x = 5\nreturn x[0]\n";
+        auto mixed = executor::executeBatch({testsDir + "test_while.txt", failingPath, testsDir + "test_arith.txt"}, 2);
+        remove(failingPath.c_str());
+        if (mixed[1].error.empty() || !mixed[0].error.empty() || !mixed[2].error.empty()) {
+            cout << "Failing script in a batch was not reported FAILED!\n";
+            allPassed = false;
+        }
+        if (mixed[0].value.asInt() != 30 || mixed[2].value.asInt() != 44) {
+            cout << "Scripts next to a failing one returned " << mixed[0].value.asInt() << " and "
+                 << mixed[2].value.asInt() << " FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Compile once and run against several sets of bindings
+    cout << "=== Running compiled program with bindings ===\n";
+    auto program = executor::compile("def scale(v, by){\n    return v * by\n}\nreturn scale(x, 2) + y\n");
+    for (int x = 0; x < 3; x++) {
+        int result = executor::run(*program, {{"x", x}, {"y", 5}}).asInt();
+        if (result != x * 2 + 5) {
+            cout << "Run with x = " << x << " returned " << result << " FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Memory is measured per run and a budget stops the script cleanly
+    cout << "=== Running with a memory budget ===\n";
+    auto arrays = executor::compile("a = [1, 2, 3, 4, 5, 6, 7, 8]\nb = a\nreturn 1\n");
+    executor::RunOptions options;
+    auto unlimited = executor::run(*arrays, {}, options);
+    options.memoryBudget = 64;
+    auto limited = executor::run(*arrays, {}, options);
+    if (unlimited.value.asInt() != 1 || unlimited.peakBytes == 0 || unlimited.outOfMemory) {
+        cout << "Unlimited run reported peak " << unlimited.peakBytes << " FAILED!\n";
+        allPassed = false;
+    }
+    if (!limited.outOfMemory || limited.value.asInt() != 0) {
+        cout << "Run over budget was not stopped FAILED!\n";
+        allPassed = false;
+    }
+    cout << endl;
+
+    // A runaway loop shares its only slot with other scripts and is stopped by its timeout
+    cout << "=== Running on the scheduler ===\n";
+    {
+        executor::Scheduler scheduler(1, 1000);
+        auto runaway = scheduler.submit(executor::compile("x = 1\nwhile(x > 0):\n    x = 1\nreturn x\n"), 0,
+                                        chrono::milliseconds(200));
+        auto finite = scheduler.submit(testsDir + "test_while.txt");
+        auto finished = finite.get();
+        auto stopped = runaway.get();
+        if (finished.value.asInt() != 30 || finished.timedOut) {
+            cout << "Script sharing a slot returned " << finished.value.asInt() << " FAILED!\n";
+            allPassed = false;
+        }
+        if (!stopped.timedOut || stopped.value.asInt() != 0) {
+            cout << "Runaway script was not timed out FAILED!\n";
+            allPassed = false;
+        }
+
+        // Functions run by pmap share the script's timeout
+        auto runawayMap = scheduler.submit(executor::compile("def spin(x){\n    while(x > 0):\n        x = 1\n"
+                                                             "    return x\n}\n"
+                                                             "return pmap(spin, [1, 2, 3])\n"),
+                                           0, chrono::milliseconds(200));
+        if (!runawayMap.get().timedOut) {
+            cout << "Runaway pmap body was not timed out FAILED!\n";
+            allPassed = false;
+        }
+
+        // A script that throws still gives its only slot back
+        auto failing = scheduler.submit(executor::compile("x = 5\nreturn x[0]\n")).get();
+        auto after = scheduler.submit(testsDir + "test_arith.txt").get();
+        if (failing.error.empty() || after.value.asInt() != 44) {
+            cout << "Slot of a failing script was not released FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // State saved at checkpoint() is restored and the rest of the script runs from there
+    cout << "=== Running from a snapshot ===\n";
+    {
+        auto warm = executor::compile(utility::readFile(testsDir + "test_snapshot.txt"));
+        const string snapshotPath = testsDir + "test_snapshot.bin";
+        const bool saved = executor::saveSnapshot(*warm, snapshotPath);
+        const int restored = executor::runFromSnapshot(*warm, snapshotPath).value.asInt();
+        remove(snapshotPath.c_str());
+        if (!saved || restored != 58) {
+            cout << "Restored run returned " << restored << " FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Type inference proves the helpers in test_functions.txt int-only. They are only called when not inlined
+    cout << "=== Inferring types ===\n";
+    executor::CompileOptions noInline;
+    noInline.inlineFunctions = false;
+    {
+        auto typed = executor::compile(utility::readFile(testsDir + "test_functions.txt"), noInline);
+        auto report = optimizer::inferTypes(*typed->ast);
+        bool found = false;
+        for (const auto& fact : report.facts) {
+            if (fact == "add(a: int, b: int) -> int") found = true;
+        }
+        if (!found || !report.failures.empty()) {
+            cout << "Expected add(a: int, b: int) -> int with no failures FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // A literal too large for an int is a parse error naming the literal and its line
+    cout << "=== Decoding numeric literals ===\n";
+    {
+        ostringstream errors;
+        streambuf* saved = cerr.rdbuf(errors.rdbuf());
+        executor::compile(utility::readFile(testsDir + "test_number_range.txt"));
+        cerr.rdbuf(saved);
+        if (errors.str().find("Error: Number out of range '3000000000' at line 3") == string::npos) {
+            cout << "Out of range literal was not reported FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Small helpers are inlined at their call sites, with the same result as calling them
+    cout << "=== Inlining functions ===\n";
+    {
+        const string source = utility::readFile(testsDir + "test_functions.txt");
+        auto plain = executor::compile(source, noInline);
+        const auto report = optimizer::inlineFunctions(*plain->ast);
+        if (report.size() != 2 || report[0] != "line 13: inlined add" || report[1] != "line 14: inlined sub") {
+            cout << "Expected add and sub to be inlined FAILED!\n";
+            allPassed = false;
+        }
+        const int called = executor::run(*executor::compile(source, noInline)).asInt();
+        const int inlined = executor::run(*executor::compile(source)).asInt();
+        if (called != 208 || inlined != 208) {
+            cout << "Called returned " << called << ", inlined returned " << inlined << " FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // C++ natives are called with their arguments unpacked, arrays by reference
+    cout << "=== Calling native functions ===\n";
+    {
+        registerNative("gcd", [](int a, int b) {
+            while (b != 0) {
+                const int rest = a % b;
+                a = b;
+                b = rest;
+            }
+            return a;
+        });
+        registerNative("total", [](const Array& values) {
+            int sum = 0;
+            for (const auto& value : values) sum += value.asInt();
+            return sum;
+        });
+        registerNative("fill", [](Array& values, int value) {
+            for (auto& element : values) element = value;
+        });
+        registerNative("iota", [](int size) {
+            Array values;
+            for (int i = 0; i < size; i++) values.push_back(i);
+            return values;
+        });
+
+        const string source =
+            "a = iota(5)\n"
+            "before = total(a)\n"
+            "fill(a, gcd(12, 18))\n"
+            "def twice(x){\n"
+            "    return gcd(x, 100) * 2\n"
+            "}\n"
+            "return before + total(a) + a[4] + twice(30)\n";
+        const int result = executor::run(*executor::compile(source)).asInt();
+        if (result != 10 + 30 + 6 + 20) {
+            cout << "Script calling natives returned " << result << " FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Large arrays are sorted on the shared pool
+    cout << "=== Sorting a large array ===\n";
+    {
+        const int size = 200000;
+        Array values;
+        for (int i = 0; i < size; i++) values.push_back(size - i);
+        const auto program = executor::compile("sort(values)\nreturn values[0] + values[199999] + find(values, 7)\n");
+        const int result = executor::run(*program, {{"values", Value(values)}}).asInt();
+        if (result != 1 + size + 6) {
+            cout << "Sorted array check returned " << result << " FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Each translation is built and must print exactly what the interpreter does, return value included
+    cout << "=== Translating scripts to C++ ===\n";
+    const bool canBuild = system((translationCompiler() + " --version" + quiet).c_str()) == 0;
+    if (!canBuild) cout << "No " << translationCompiler() << " to build translations with, only translating\n";
+    for (const auto& test : tests) {
+        if (test.filename == "test_errors.txt") continue;  // Refused, see below
+        auto translated = executor::compile(utility::readFile(testsDir + test.filename));
+        ostringstream cpp;
+        if (!codegen::emitCpp(*translated->ast, cpp) || cpp.str().find("int main() {") == string::npos) {
+            cout << "Translating " << test.filename << " FAILED!\n";
+            allPassed = false;
+            continue;
+        }
+        if (!canBuild) continue;
+        const string stem = test.filename.substr(0, test.filename.find('.'));
+        string printed;
+        if (!runTranslation(cpp.str(), stem, printed)) {
+            cout << "Building the translation of " << test.filename << " FAILED!\n";
+            allPassed = false;
+        } else if (printed != interpreterOutput(*translated)) {
+            cout << "Translation of " << test.filename << " printed something else FAILED!\n";
+            allPassed = false;
+        }
+    }
+    // Syntax errors leave gaps in the tree, which are reported instead of translated
+    auto broken = executor::compile(utility::readFile(testsDir + "test_errors.txt"));
+    ostringstream discarded;
+    if (codegen::emitCpp(*broken->ast, discarded)) {
+        cout << "Translating test_errors.txt was not refused FAILED!\n";
+        allPassed = false;
+    }
+    cout << endl;
+
+    // Shapes that are not multiples of the tile size, large enough for the product to be split across threads
+    cout << "=== Multiplying matrices ===\n";
+    {
+        const int n = 200, k = 150, m = 160;
+        Matrix a(n, k), b(k, m);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < k; j++) a.at(i, j) = (i * 7 + j * 3) % 11 - 5;
+        }
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < m; j++) b.at(i, j) = (i * 5 + j) % 13 - 6;
+        }
+        const auto program = executor::compile("return matmul(a, b)\n");
+        const Value product = executor::run(*program, {{"a", Value(a)}, {"b", Value(b)}});
+        bool correct = product.isMatrix() && product.asMatrix().rows() == n && product.asMatrix().cols() == m;
+        for (int i = 0; correct && i < n; i++) {
+            for (int j = 0; correct && j < m; j++) {
+                int expected = 0;
+                for (int x = 0; x < k; x++) expected += a.at(i, x) * b.at(x, j);
+                correct = product.asMatrix().at(i, j) == expected;
+            }
+        }
+        if (!correct) {
+            cout << "Matrix product check FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Profiling records every phase and each script function call, and the trace names them
+    cout << "=== Profiling a run ===\n";
+    {
+        Profile profile;
+        Trace trace;
+        profile.trace = &trace;
+        executor::RunOptions options;
+        options.compileOptions = noInline;
+        options.profile = &profile;
+        const int result = executor::executeFile(testsDir + "test_functions.txt", options).value.asInt();
+
+        const string tracePath = testsDir + "test_trace.json";
+        const bool written = trace.write(tracePath);
+        const string json = utility::readFile(tracePath);
+        remove(tracePath.c_str());
+        if (result != 208 || profile.phases.size() != 5 || profile.functionCalls != 2 || profile.tokens == 0 ||
+            profile.astNodes == 0 || profile.variableLookups == 0) {
+            cout << "Profile missed phases or counters FAILED!\n";
+            allPassed = false;
+        }
+        if (!written || json.find("\"traceEvents\"") == string::npos || json.find("\"name\":\"add\"") == string::npos) {
+            cout << "Trace did not record the call to add FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // A loop body that declares nothing runs without a scope, and one that does reuses its scope's entries, so neither
+    // allocates per iteration
+    cout << "=== Reusing block scopes ===\n";
+    {
+        auto allocationsFor = [](const string& body, int iterations, Profile& profile) {
+            auto program = executor::compile("total = 0\ni = 0\nwhile(i < " + to_string(iterations) + "):\n" + body +
+                                             "    i = i + 1\nreturn total\n");
+            MemoryTracker tracker;
+            MemoryTracker::Activation activation(&tracker);
+            Interpreter interpreter;
+            interpreter.profile = &profile;
+            interpreter.evaluate(program->ast);
+            return tracker.allocationCount();
+        };
+        const string declaring = "    fresh = i\n    total = total + fresh\n";
+        Profile few, many, plain;
+        const size_t fewAllocations = allocationsFor(declaring, 10, few);
+        const size_t manyAllocations = allocationsFor(declaring, 1000, many);
+        allocationsFor("    total = total + i\n", 1000, plain);
+        if (manyAllocations != fewAllocations || many.scopePushes < 1000) {
+            cout << "Loop body scope allocated " << manyAllocations - fewAllocations << " times FAILED!\n";
+            allPassed = false;
+        }
+        if (plain.scopePushes != 0) {
+            cout << "Loop body without declarations pushed " << plain.scopePushes << " scopes FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // Size classes cover every small request, and a run reuses the array buffers it frees
+    cout << "=== Pooling array buffers ===\n";
+    {
+        for (size_t bytes = 1; bytes <= ArrayPool::largestBlock; bytes++) {
+            const size_t sizeClass = ArrayPool::classOf(bytes);
+            if (sizeClass >= ArrayPool::classCount || ArrayPool::classSize(sizeClass) < bytes ||
+                (sizeClass > 0 && ArrayPool::classSize(sizeClass - 1) >= bytes)) {
+                cout << "Size class of " << bytes << " bytes is wrong FAILED!\n";
+                allPassed = false;
+                break;
+            }
+        }
+
+        auto program = executor::compile(
+            "total = 0\n"
+            "for i in range(0, 1000):\n"
+            "    row = [i, i + 1, i + 2]\n"
+            "    total += row[1]\n"
+            "return total\n");
+        Profile pooled;
+        Profile plain;
+        executor::RunOptions options;
+        options.profile = &pooled;
+        const int pooledResult = executor::run(*program, {}, options).value.asInt();
+        options.profile = &plain;
+        options.pooledArrays = false;
+        const int plainResult = executor::run(*program, {}, options).value.asInt();
+        if (pooledResult != 500500 || plainResult != 500500 || pooled.poolHits < 1000 || plain.poolHits != 0 ||
+            plain.poolMisses != 0) {
+            cout << "Pool did not serve the loop's arrays FAILED!\n";
+            allPassed = false;
+        }
+
+        // An interpreter going back to the executor's pool gives its cached blocks back
+        Interpreter interpreter;
+        {
+            ArrayPool::Activation pooling(&interpreter.arrayPool);
+            Array row(64, Value(1));
+        }
+        const size_t cached = interpreter.arrayPool.cachedBytes();
+        interpreter.reset();
+        if (cached == 0 || interpreter.arrayPool.cachedBytes() != 0) {
+            cout << "Reset interpreter kept " << interpreter.arrayPool.cachedBytes() << " cached bytes FAILED!\n";
+            allPassed = false;
+        }
+    }
+    cout << endl;
+
+    // The sampling profiler attributes CPU time to the script function that was running. Windows has no SIGPROF
+    cout << "=== Sampling a run ===\n";
+#ifndef _WIN32
+    {
+        const string source =
+            "def spin(n){\n"
+            "    i = 0\n"
+            "    while(i < n):\n"
+            "        i = i + 1\n"
+            "    return i\n"
+            "}\n"
+            "return spin(3000000)\n";
+        const auto program = executor::compile(source);
+        Sampler sampler("sampled", 1000);
+        executor::RunOptions options;
+        if (sampler.start()) options.shadow = &sampler.stack();
+        executor::run(*program, {}, options);
+        sampler.stop();
+
+        const string foldedPath = testsDir + "test_samples.folded";
+        sampler.writeFolded(foldedPath);
+        const string folded = utility::readFile(foldedPath);
+        remove(foldedPath.c_str());
+        if (sampler.sampleCount() == 0 || folded.find("sampled:7;spin:") == string::npos) {
+            cout << "No samples inside spin() FAILED!\n";
+            allPassed = false;
+        }
+    }
+#endif
+    cout << endl;
+
+    // A daemon on a temporary socket answers one good request and refuses a malformed one
+    cout << "=== Serving requests ===\n";
+#ifndef _WIN32
+    {
+        const string socketPath = testsDir + "test_serve.sock";
+        remove(socketPath.c_str());
+        thread([socketPath] { server::serve(socketPath); }).detach();
+        struct stat info;
+        for (int wait = 0; wait < 200 && stat(socketPath.c_str(), &info) != 0; wait++) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+
+        // Sends an inline script, returning what `request` printed
+        auto send = [&](const string& source, const vector<string>& args, int& status) {
+            istringstream input(source);
+            ostringstream printed;
+            streambuf* savedIn = cin.rdbuf(input.rdbuf());
+            streambuf* savedOut = cout.rdbuf(printed.rdbuf());
+            status = server::request(socketPath, "-", args);
+            cin.rdbuf(savedIn);
+            cout.rdbuf(savedOut);
+            return printed.str();
+        };
+
+        // The socket exists just before it starts listening, so the first connection may be refused
+        int status = 0;
+        string printed;
+        for (int attempt = 0; attempt < 20 && status != 42; attempt++) {
+            if (attempt > 0) this_thread::sleep_for(chrono::milliseconds(50));
+            printed = send("print x\nreturn x + 1\n", {"x=41"}, status);
+        }
+        if (status != 42 || printed != "41\nScript returned 42") {
+            cout << "Request returned " << status << " and printed '" << printed << "' FAILED!\n";
+            allPassed = false;
+        }
+
+        // The server has written everything it logs before accepting, so its errors can be captured now
+        ostringstream errors;
+        streambuf* savedErr = cerr.rdbuf(errors.rdbuf());
+        printed = send("return x\n", {"x=forty"}, status);
+        cerr.rdbuf(savedErr);
+        if (status != 1 || !printed.empty() || errors.str().find("ERROR: Invalid argument 'x forty'") == string::npos) {
+            cout << "Bad binding was not refused by the server FAILED!\n";
+            allPassed = false;
+        }
+        remove(socketPath.c_str());
+    }
+#endif
+    cout << endl;
+
     if (allPassed) {
         cout << "All tests passed!\n";
     } else {